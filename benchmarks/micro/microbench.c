@@ -0,0 +1,332 @@
+#include "include/blu.h"
+
+#include <time.h>
+
+#include "vm/memory.h"
+#include "vm/object.h"
+#include "vm/parser/parser.h"
+#include "vm/table.h"
+#include "vm/vm.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Microbenchmarks of the internals of the VM, linked directly against its objects. Every benchmark runs at a few sizes,
+// each size is repeated and the fastest repetition is reported, as time per operation and cycles per operation.
+// scripts/microbench.sh builds and runs it, a name filter picks the benchmarks to run.
+
+#define REPEATS 5
+
+// Operations done by one repetition of a benchmark, whatever its size.
+#define OPS_PER_REPEAT (1 << 21)
+
+typedef struct {
+	uint64_t startCycles;
+	struct timespec startTime;
+
+	// Best repetition so far.
+	double nanosPerOp;
+	double cyclesPerOp;
+} Timer;
+
+static uint64_t readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void startTimer(Timer* timer) {
+	clock_gettime(CLOCK_MONOTONIC, &timer->startTime);
+	timer->startCycles = readCycles();
+}
+
+static void stopTimer(Timer* timer, int64_t ops) {
+	uint64_t cycles = readCycles() - timer->startCycles;
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double nanos = (end.tv_sec - timer->startTime.tv_sec) * 1e9 + (end.tv_nsec - timer->startTime.tv_nsec);
+
+	if (nanos / ops < timer->nanosPerOp) {
+		timer->nanosPerOp = nanos / ops;
+		timer->cyclesPerOp = (double)cycles / ops;
+	}
+}
+
+// Strings "key0", "key1", ... interned by [vm], padded to at least [length] characters.
+static bluObjString** makeKeys(bluVM* vm, int32_t count, int32_t length) {
+	bluObjString** keys = malloc(sizeof(bluObjString*) * count);
+	char chars[1024];
+
+	for (int32_t i = 0; i < count; i++) {
+		int32_t written = snprintf(chars, sizeof(chars), "key%d", i);
+		while (written < length) chars[written++] = '_';
+
+		keys[i] = bluCopyString(vm, chars, written);
+	}
+
+	return keys;
+}
+
+// Keeps [value] alive across collections until the global is deleted.
+static void setRoot(bluVM* vm, bluValue value) {
+	bluTableSet(vm, &vm->globals, bluCopyString(vm, "microbench", 10), value);
+}
+
+static void deleteRoot(bluVM* vm) {
+	bluTableDelete(vm, &vm->globals, bluCopyString(vm, "microbench", 10));
+}
+
+static void benchTableSet(bluVM* vm, Timer* timer, int32_t size) {
+	bluObjString** keys = makeKeys(vm, size, 0);
+	bluTable table;
+
+	startTimer(timer);
+
+	for (int32_t round = 0; round < OPS_PER_REPEAT / size; round++) {
+		bluTableInit(vm, &table);
+
+		for (int32_t i = 0; i < size; i++) {
+			bluTableSet(vm, &table, keys[i], NUMBER_VAL(i));
+		}
+
+		bluTableFree(vm, &table);
+	}
+
+	stopTimer(timer, OPS_PER_REPEAT / size * size);
+
+	free(keys);
+}
+
+static void benchTableGet(bluVM* vm, Timer* timer, int32_t size, bool hit) {
+	bluObjString** keys = makeKeys(vm, size * 2, 0);
+	bluTable table;
+	bluTableInit(vm, &table);
+
+	// The other half of the keys misses.
+	for (int32_t i = 0; i < size; i++) {
+		bluTableSet(vm, &table, keys[i * 2], NUMBER_VAL(i));
+	}
+
+	int32_t offset = hit ? 0 : 1;
+	int32_t found = 0;
+	bluValue value;
+
+	startTimer(timer);
+
+	for (int32_t round = 0; round < OPS_PER_REPEAT / size; round++) {
+		for (int32_t i = 0; i < size; i++) {
+			found += bluTableGet(vm, &table, keys[i * 2 + offset], &value);
+		}
+	}
+
+	stopTimer(timer, OPS_PER_REPEAT / size * size);
+
+	if (found != (hit ? OPS_PER_REPEAT / size * size : 0)) fprintf(stderr, "Table lookups went wrong.\n");
+
+	bluTableFree(vm, &table);
+	free(keys);
+}
+
+static void benchTableGetHit(bluVM* vm, Timer* timer, int32_t size) {
+	benchTableGet(vm, timer, size, true);
+}
+
+static void benchTableGetMiss(bluVM* vm, Timer* timer, int32_t size) {
+	benchTableGet(vm, timer, size, false);
+}
+
+// Interning a string already interned: hashing its characters and finding it in the string table. The size is the
+// length of the string.
+static void benchInternHit(bluVM* vm, Timer* timer, int32_t size) {
+	bluObjString** keys = makeKeys(vm, 64, size);
+
+	startTimer(timer);
+
+	for (int32_t round = 0; round < OPS_PER_REPEAT / 64; round++) {
+		for (int32_t i = 0; i < 64; i++) {
+			bluCopyString(vm, keys[i]->chars, keys[i]->length);
+		}
+	}
+
+	stopTimer(timer, OPS_PER_REPEAT / 64 * 64);
+
+	free(keys);
+}
+
+// Interning new strings, allocated and added to the string table. The size is the length of the string.
+static void benchInternNew(bluVM* vm, Timer* timer, int32_t size) {
+	int32_t count = OPS_PER_REPEAT / 16;
+	char* chars = malloc(size + 16);
+	memset(chars, 'x', size + 16);
+
+	startTimer(timer);
+
+	for (int32_t i = 0; i < count; i++) {
+		int32_t written = snprintf(chars, size + 16, "%d", i);
+		chars[written] = 'x';
+
+		bluCopyString(vm, chars, written > size ? written : size);
+	}
+
+	stopTimer(timer, count);
+
+	free(chars);
+	bluCollectGarbage(vm);
+}
+
+// Allocating arrays of [size] elements and collecting them again. Includes the time of the sweep.
+static void benchAllocate(bluVM* vm, Timer* timer, int32_t size) {
+	int32_t count = OPS_PER_REPEAT / 16;
+
+	startTimer(timer);
+
+	for (int32_t i = 0; i < count; i++) {
+		bluNewArray(vm, size);
+	}
+
+	bluCollectGarbage(vm);
+
+	stopTimer(timer, count);
+}
+
+// Tokens of a source made of [size] copies of a small class.
+static void benchLexer(bluVM* vm, Timer* timer, int32_t size) {
+	static const char* snippet = "class Point {\n"
+	                             "    fn __init(x, y) {\n"
+	                             "        @x = x\n"
+	                             "        @y = y\n"
+	                             "    }\n"
+	                             "\n"
+	                             "    fn length(): (@x * @x + @y * @y) / 2.5 // Not quite.\n"
+	                             "}\n"
+	                             "\n"
+	                             "var name = \"point\"\n";
+
+	ByteBuffer source;
+	ByteBufferInit(&source);
+
+	for (int32_t i = 0; i < size; i++) {
+		ByteBufferAppend(&source, snippet, strlen(snippet));
+	}
+
+	ByteBufferWrite(&source, '\0');
+
+	int64_t tokens = 0;
+	bluParser parser;
+
+	startTimer(timer);
+
+	while (tokens < OPS_PER_REPEAT) {
+		bluParserInit(&parser, (const char*)source.data);
+
+		bluToken token;
+		do {
+			token = bluParserNextToken(&parser);
+			tokens++;
+		} while (token.type != TOKEN_EOF && token.type != TOKEN_ERROR);
+	}
+
+	stopTimer(timer, tokens);
+
+	ByteBufferFree(&source);
+}
+
+// Collections of a heap of [size] live arrays, each holding a number and a string. Time per live object.
+static void benchMark(bluVM* vm, Timer* timer, int32_t size) {
+	bluObjArray* root = bluNewArray(vm, size);
+	setRoot(vm, OBJ_VAL(root));
+
+	for (int32_t i = 0; i < size; i++) {
+		bluObjArray* array = bluNewArray(vm, 2);
+		array->data[0] = NUMBER_VAL(i);
+		array->data[1] = OBJ_VAL(bluCopyString(vm, "live", 4));
+
+		root->data[i] = OBJ_VAL(array);
+	}
+
+	int32_t collections = OPS_PER_REPEAT / 4 / size + 1;
+
+	startTimer(timer);
+
+	for (int32_t i = 0; i < collections; i++) {
+		bluCollectGarbage(vm);
+	}
+
+	stopTimer(timer, (int64_t)collections * size);
+
+	deleteRoot(vm);
+	bluCollectGarbage(vm);
+}
+
+// Collections freeing [size] dead arrays. Time per dead object.
+static void benchSweep(bluVM* vm, Timer* timer, int32_t size) {
+	int32_t collections = OPS_PER_REPEAT / 4 / size + 1;
+
+	for (int32_t i = 0; i < collections; i++) {
+		for (int32_t j = 0; j < size; j++) {
+			bluNewArray(vm, 2);
+		}
+
+		// Only the collection is timed, the timer keeps the best one.
+		startTimer(timer);
+		bluCollectGarbage(vm);
+		stopTimer(timer, size);
+	}
+}
+
+typedef struct {
+	const char* name;
+	void (*run)(bluVM* vm, Timer* timer, int32_t size);
+	int32_t sizes[4];
+} Benchmark;
+
+static Benchmark benchmarks[] = {
+    {"table_set", benchTableSet, {8, 1024, 65536, 0}},
+    {"table_get_hit", benchTableGetHit, {8, 1024, 65536, 1 << 20}},
+    {"table_get_miss", benchTableGetMiss, {8, 1024, 65536, 1 << 20}},
+    {"intern_hit", benchInternHit, {4, 16, 64, 256}},
+    {"intern_new", benchInternNew, {4, 16, 64, 256}},
+    {"allocate_array", benchAllocate, {0, 2, 16, 128}},
+    {"lexer", benchLexer, {1, 100, 10000, 0}},
+    {"gc_mark", benchMark, {1024, 65536, 1 << 20, 0}},
+    {"gc_sweep", benchSweep, {1024, 65536, 1 << 20, 0}},
+};
+
+int main(int argc, const char* argv[]) {
+	const char* filter = argc > 1 ? argv[1] : "";
+
+	printf(" %-16s %10s %12s %12s\n", "benchmark", "size", "ns / op", "cycles / op");
+
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(Benchmark); i++) {
+		Benchmark* benchmark = &benchmarks[i];
+		if (strstr(benchmark->name, filter) == NULL) continue;
+
+		for (int32_t j = 0; j < 4; j++) {
+			int32_t size = benchmark->sizes[j];
+			if (size == 0 && j > 0) break;
+
+			// Every size gets a VM of its own, so what one left behind doesn't slow the next.
+			bluVM* vm = bluNewVM();
+
+			Timer timer;
+			timer.nanosPerOp = INFINITY;
+			timer.cyclesPerOp = 0;
+
+			for (int32_t repeat = 0; repeat < REPEATS; repeat++) {
+				benchmark->run(vm, &timer, size);
+			}
+
+			printf(" %-16s %10d %12.2f %12.1f\n", benchmark->name, size, timer.nanosPerOp, timer.cyclesPerOp);
+			fflush(stdout);
+
+			bluFreeVM(vm);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+#!/usr/bin/env python
+
+# Runs the benchmark suite: every benchmarks/<name>/blu.blu is run a few times to warm up the caches and then the
+# measured number of times. Reports the median and standard deviation of the wall time and the peak resident set size of
+# every benchmark. The results can be saved as JSON and later passed back as the baseline, benchmarks which got slower
+# than the baseline by more than the threshold are flagged and make the runner exit with an error.
+
+import argparse
+import datetime
+import json
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+BENCHMARKS_PATH = 'benchmarks'
+
+
+def find_benchmarks(names):
+    available = sorted(name for name in os.listdir(BENCHMARKS_PATH)
+                       if os.path.isfile(os.path.join(BENCHMARKS_PATH, name, 'blu.blu')))
+
+    for name in names:
+        if name not in available:
+            sys.exit('Unknown benchmark "{0}", available are: {1}'.format(name, ', '.join(available)))
+
+    return names or available
+
+
+# Runs the script once, returns the wall time in seconds and the peak resident set size in KiB. Stderr goes to a file,
+# a pipe nobody reads until the script exits would block a script writing more than fits in it.
+def run(blu, script):
+    with tempfile.TemporaryFile() as stderr:
+        start = time.perf_counter()
+        process = subprocess.Popen([blu, script], stdout=subprocess.DEVNULL, stderr=stderr)
+        _, status, usage = os.wait4(process.pid, 0)
+        wall = time.perf_counter() - start
+
+        process.returncode = os.waitstatus_to_exitcode(status)
+        if process.returncode != 0:
+            stderr.seek(0)
+            sys.exit('{0} failed with exit code {1}:\n{2}'.format(script, process.returncode,
+                                                                   stderr.read().decode()))
+
+    return wall, usage.ru_maxrss
+
+
+def measure(blu, name, warmup, runs):
+    script = os.path.join(BENCHMARKS_PATH, name, 'blu.blu')
+
+    for _ in range(warmup):
+        run(blu, script)
+
+    times = []
+    rss = 0
+
+    for _ in range(runs):
+        wall, peak = run(blu, script)
+        times.append(wall)
+        rss = max(rss, peak)
+
+    return {
+        'times': times,
+        'median': statistics.median(times),
+        'stddev': statistics.stdev(times) if len(times) > 1 else 0.0,
+        'min': min(times),
+        'max_rss_kib': rss,
+    }
+
+
+def version(blu):
+    return subprocess.run([blu, '--version'], capture_output=True, text=True).stdout.strip()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Run the blu benchmark suite.')
+    parser.add_argument('benchmarks', nargs='*', help='Names of the benchmarks to run, all by default')
+    parser.add_argument('--blu', default='./blu', help='The blu executable')
+    parser.add_argument('--warmup', type=int, default=1, help='Runs before measuring')
+    parser.add_argument('--runs', type=int, default=5, help='Measured runs')
+    parser.add_argument('--json', help='Write the results to this file')
+    parser.add_argument('--baseline', help='Compare with the results saved in this file')
+    parser.add_argument('--threshold', type=float, default=5.0,
+                        help='Percentage by which a median may exceed the baseline before it is a regression')
+    args = parser.parse_args()
+
+    if args.runs < 1:
+        sys.exit('At least one measured run is needed.')
+
+    benchmarks = find_benchmarks(args.benchmarks)
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as file:
+            baseline = json.load(file)['benchmarks']
+
+    print(' => {0}, {1} warmup and {2} measured runs'.format(version(args.blu), args.warmup, args.runs))
+    print(' {0:<14} {1:>10} {2:>10} {3:>12} {4:>10}'.format('benchmark', 'median (s)', 'stddev', 'peak RSS', 'baseline'))
+
+    results = {}
+    regressions = []
+
+    for name in benchmarks:
+        result = measure(args.blu, name, args.warmup, args.runs)
+        results[name] = result
+
+        comparison = ''
+        if name in baseline:
+            change = (result['median'] / baseline[name]['median'] - 1) * 100
+            comparison = '{0:+.1f}%'.format(change)
+
+            # Changes within the noise of either run are not regressions, however large they are relatively.
+            noise = max(result['stddev'], baseline[name]['stddev'])
+            if change > args.threshold and result['median'] - baseline[name]['median'] > 2 * noise:
+                comparison += ' !'
+                regressions.append(name)
+
+        print(' {0:<14} {1:>10.3f} {2:>10.3f} {3:>9} KiB {4:>10}'.format(name, result['median'], result['stddev'],
+                                                                         result['max_rss_kib'], comparison))
+
+    if args.json:
+        with open(args.json, 'w') as file:
+            json.dump({
+                'version': version(args.blu),
+                'date': datetime.datetime.now().isoformat(timespec='seconds'),
+                'machine': platform.machine(),
+                'warmup': args.warmup,
+                'runs': args.runs,
+                'benchmarks': results,
+            }, file, indent=2)
+
+    if regressions:
+        print('\n Slower than the baseline by more than {0}%: {1}'.format(args.threshold, ', '.join(regressions)))
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -1,7 +1,11 @@
 #!/usr/bin/env bash
 
+# Compares blu with other languages on the benchmarks implemented in them as well, see bench.py for the whole suite.
+
 for i in ./benchmarks/*
 do
+    [[ -f "$i/python.py" ]] || continue
+
     printf " => %s\n" $i
 
     printf " => Benchmarking blu: "
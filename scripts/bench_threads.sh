@@ -0,0 +1,26 @@
+#!/usr/bin/env bash
+
+# Measures how running a script on several threads at once scales. Every run uses `blu --jobs <n>`, which executes the
+# script n times in parallel, each time on its own VM from a pool. With perfect scaling the wall time stays the same as
+# the number of jobs grows, up to the number of cores.
+
+BENCHMARK=${1:-"./benchmarks/fibonacci/blu.blu"}
+MAX_JOBS=${2:-$(( $(nproc) * 2 ))}
+
+printf " => %s (%d cores)\n" "$BENCHMARK" "$(nproc)"
+printf " %6s %10s %14s %12s\n" "jobs" "wall (s)" "jobs / second" "efficiency"
+
+TIMEFORMAT="%R"
+BASE=""
+
+for (( jobs = 1; jobs <= MAX_JOBS; jobs *= 2 ))
+do
+    WALL=$( { time ./blu --jobs $jobs "$BENCHMARK" >/dev/null; } 2>&1 | tail -n 1 )
+    BASE=${BASE:-$WALL}
+
+    # Efficiency compares the throughput with [jobs] times the throughput of a single job, capped by the core count.
+    awk -v jobs=$jobs -v wall=$WALL -v base=$BASE -v cores=$(nproc) 'BEGIN {
+        ideal = jobs < cores ? jobs : cores
+        printf " %6d %10.3f %14.2f %11.0f%%\n", jobs, wall, jobs / wall, 100 * (jobs / wall) / (ideal / base)
+    }'
+done
@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+
+# Compares the stack and the register operand (BLU_REGISTER_VM) instruction encodings. Every variant is built twice,
+# once for timing and once with BLU_COUNT_INSTRUCTIONS to report the number of dispatched instructions. The JIT is left
+# out of all of them, its native code would run instead of the instructions being compared.
+
+CC=${CC:-gcc}
+FLAGS="-std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -D NDEBUG -D BLU_NO_JIT -O3 -I ./src"
+SOURCES=$(find ./src -name '*.c')
+BIN_PATH=bin/bench
+
+BENCHMARKS=${@:-"./benchmarks/fibonacci/blu.blu ./benchmarks/binarytrees/blu.blu"}
+
+mkdir -p $BIN_PATH
+
+printf " => Building variants\n"
+$CC $FLAGS $SOURCES -lm -pthread -o $BIN_PATH/blu-stack || exit 1
+$CC $FLAGS -D BLU_REGISTER_VM $SOURCES -lm -pthread -o $BIN_PATH/blu-register || exit 1
+$CC $FLAGS -D BLU_COUNT_INSTRUCTIONS $SOURCES -lm -pthread -o $BIN_PATH/blu-stack-count || exit 1
+$CC $FLAGS -D BLU_COUNT_INSTRUCTIONS -D BLU_REGISTER_VM $SOURCES -lm -pthread -o $BIN_PATH/blu-register-count || exit 1
+echo ""
+
+for i in $BENCHMARKS
+do
+    printf " => %s\n" $i
+
+    for vm in stack register
+    do
+        printf " => %-8s " $vm
+        $BIN_PATH/blu-$vm-count "$i" 2>&1 >/dev/null | grep "Instructions executed"
+
+        TIMEFORMAT="              Wall time: %3Rs"
+        time $BIN_PATH/blu-$vm "$i" >/dev/null
+    done
+
+    echo ""
+done
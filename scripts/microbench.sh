@@ -0,0 +1,17 @@
+#!/usr/bin/env bash
+
+# Builds the microbenchmarks of benchmarks/micro against the objects of the VM and runs them. The only argument filters
+# the benchmarks by name, e.g. "table" or "gc".
+
+CC=${CC:-gcc}
+FLAGS="-std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -D NDEBUG -O3 -I ./src"
+SOURCES=$(find ./src -name '*.c' -not -path './src/cmd/*')
+BIN_PATH=bin/microbench
+
+mkdir -p $BIN_PATH
+
+printf " => Building\n"
+$CC $FLAGS $SOURCES ./benchmarks/micro/microbench.c -lm -pthread -o $BIN_PATH/microbench || exit 1
+echo ""
+
+$BIN_PATH/microbench "$1"
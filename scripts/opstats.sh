@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+
+# Builds the VM with BLU_OPSTATS and reports how often every instruction and pair of instructions ran in each script.
+
+CC=${CC:-gcc}
+FLAGS="-std=c11 -Wall -Wextra -Werror -Wno-unused-parameter -D NDEBUG -O3 -I ./src -D BLU_OPSTATS"
+SOURCES=$(find ./src -name '*.c')
+BIN_PATH=bin/opstats
+
+SCRIPTS=${@:-"./benchmarks/fibonacci/blu.blu ./benchmarks/binarytrees/blu.blu"}
+
+mkdir -p $BIN_PATH
+
+printf " => Building\n"
+$CC $FLAGS $SOURCES -lm -pthread -o $BIN_PATH/blu || exit 1
+echo ""
+
+for i in $SCRIPTS
+do
+    printf " => %s\n" $i
+
+    $BIN_PATH/blu "$i" 2>&1 >/dev/null
+
+    echo ""
+done
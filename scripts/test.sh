@@ -11,6 +11,20 @@ do
     then
         CODE=1
     fi
+
+    ./blu --no-jit "$f" >/dev/null
+    if [ 0 -ne $? ]
+    then
+        printf "    (failed without the JIT)\n"
+        CODE=1
+    fi
+
+    ./blu --jobs 2 "$f" >/dev/null
+    if [ 0 -ne $? ]
+    then
+        printf "    (failed on two threads with a shared image)\n"
+        CODE=1
+    fi
 done
 
 if [ 0 -eq $CODE ]
@@ -1,9 +1,170 @@
+#include <pthread.h>
+#include <time.h>
+
 #include "include/blu.h"
 
+// Samples per second of CPU time taken with --profile.
+#define PROFILE_FREQUENCY 1000
+
+// Bytes allocated between two samples taken with --alloc-profile.
+#define ALLOCATION_INTERVAL 16384
+
+// Events kept by --trace, the oldest are dropped once there are more.
+#define TRACE_CAPACITY (1 << 20)
+
+typedef struct {
+	bool jit;
+	bool sharedImage;
+	int32_t jobs;
+	const char* profile;
+	const char* allocationProfile;
+	const char* trace;
+	bool traceStartup;
+} Options;
+
+static Options options = {
+	.jit = true,
+	.sharedImage = false,
+	.jobs = 1,
+	.profile = NULL,
+	.allocationProfile = NULL,
+	.trace = NULL,
+	.traceStartup = false,
+};
+
+typedef struct {
+	pthread_t thread;
+	bluVMPool* pool;
+	const char* source;
+	const char* path;
+	bluInterpretResult result;
+} Job;
+
+static bluImage* image = NULL;
+
+// Collapsed stacks of --profile and allocation sites of --alloc-profile. Every job appends its own samples.
+static FILE* profile = NULL;
+static FILE* allocationProfile = NULL;
+
+// Trace events of --trace. A file holds a single trace, so only the first job to finish writes one.
+static FILE* trace = NULL;
+static pthread_mutex_t profileLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void startProfile(bluVM* vm) {
+	if (profile != NULL && !bluStartProfiler(vm, PROFILE_FREQUENCY)) {
+		fprintf(stderr, "Could not start the profiler.\n");
+	}
+
+	if (allocationProfile != NULL) bluStartAllocationProfiler(vm, ALLOCATION_INTERVAL);
+
+	// The first job to finish closes the trace, maybe while others are starting.
+	if (options.trace != NULL) {
+		pthread_mutex_lock(&profileLock);
+		if (trace != NULL) bluStartTrace(vm, TRACE_CAPACITY);
+		pthread_mutex_unlock(&profileLock);
+	}
+}
+
+static void stopProfile(bluVM* vm) {
+	if (profile == NULL && allocationProfile == NULL && options.trace == NULL) return;
+
+	pthread_mutex_lock(&profileLock);
+	bluStopProfiler(vm, profile);
+	bluStopAllocationProfiler(vm, allocationProfile);
+	bluStopTrace(vm, trace);
+
+	if (trace != NULL) {
+		fclose(trace);
+		trace = NULL;
+	}
+
+	pthread_mutex_unlock(&profileLock);
+}
+
+// Phases of startup timed with --trace-startup, most of them reported by the VM.
+#define STARTUP_PHASES_MAX 16
+
+typedef struct {
+	const char* name;
+	int64_t time;
+} StartupPhase;
+
+static StartupPhase startupPhases[STARTUP_PHASES_MAX];
+static int32_t startupPhaseCount = 0;
+
+static void markStartup(const char* name) {
+	if (startupPhaseCount == STARTUP_PHASES_MAX) return;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	startupPhases[startupPhaseCount].name = name;
+	startupPhases[startupPhaseCount].time = now.tv_sec * 1000000000 + now.tv_nsec;
+	startupPhaseCount++;
+}
+
+static void traceStartup(bluVM* vm, bluStartupPhase phase, int64_t time, void* data) {
+	if (startupPhaseCount == STARTUP_PHASES_MAX) return;
+
+	startupPhases[startupPhaseCount].name = bluStartupPhaseName(phase);
+	startupPhases[startupPhaseCount].time = time;
+	startupPhaseCount++;
+}
+
+// Prints how long each phase took and the time since main() was entered to stderr.
+static void printStartup() {
+	if (!options.traceStartup) return;
+
+	fprintf(stderr, " %-20s %10s %10s\n", "startup phase", "ms", "total ms");
+
+	for (int32_t i = 1; i < startupPhaseCount; i++) {
+		fprintf(stderr, " %-20s %10.3f %10.3f\n", startupPhases[i].name,
+		        (startupPhases[i].time - startupPhases[i - 1].time) / 1e6,
+		        (startupPhases[i].time - startupPhases[0].time) / 1e6);
+	}
+}
+
+static FILE* openProfile(const char* path) {
+	FILE* file = fopen(path, "w");
+
+	if (file == NULL) {
+		fprintf(stderr, "Could not open file \"%s\".\n", path);
+		exit(74);
+	}
+
+	return file;
+}
+
+static bluVM* newVM() {
+	bluVMConfig config;
+	bluInitVMConfig(&config);
+
+	if (options.sharedImage) {
+		image = bluNewImage();
+		config.image = image;
+
+		markStartup("image loaded");
+	}
+
+	if (options.traceStartup) config.startupHook = traceStartup;
+
+	bluVM* vm = bluNewVMWithConfig(&config);
+	markStartup("vm created");
+	bluSetJitEnabled(vm, options.jit);
+
+	return vm;
+}
+
+static void freeVM(bluVM* vm) {
+	bluFreeVM(vm);
+
+	if (image != NULL) bluFreeImage(image);
+}
+
 static void repl() {
 	char line[1024];
 
-	bluVM* vm = bluNewVM();
+	bluVM* vm = newVM();
 
 	while (true) {
 		printf("> ");
@@ -16,7 +177,7 @@ static void repl() {
 		bluInterpret(vm, line, "REPL");
 	}
 
-	bluFreeVM(vm);
+	freeVM(vm);
 }
 
 static char* readFile(const char* path) {
@@ -48,23 +209,88 @@ static char* readFile(const char* path) {
 	return buffer;
 }
 
+static void exitOnError(bluInterpretResult result) {
+	if (result == INTERPRET_COMPILE_ERROR) exit(65);
+	if (result == INTERPRET_RUNTIME_ERROR) exit(70);
+	if (result == INTERPRET_ASSERTION_ERROR) exit(75);
+}
+
 static void runFile(const char* path) {
-	bluVM* vm = bluNewVM();
+	bluVM* vm = newVM();
 	char* source = readFile(path);
+	markStartup("script read");
 
+	startProfile(vm);
 	bluInterpretResult result = bluInterpret(vm, source, path);
+	stopProfile(vm);
+
+	markStartup("script ran");
+	printStartup();
 
 	free(source);
-	bluFreeVM(vm);
+	freeVM(vm);
 
-	if (result == INTERPRET_COMPILE_ERROR) exit(65);
-	if (result == INTERPRET_RUNTIME_ERROR) exit(70);
-	if (result == INTERPRET_ASSERTION_ERROR) exit(75);
+	exitOnError(result);
+}
+
+static void* runJob(void* arg) {
+	Job* job = (Job*)arg;
+
+	bluVM* vm = bluAcquireVM(job->pool);
+	bluSetJitEnabled(vm, options.jit);
+
+	startProfile(vm);
+	job->result = bluInterpret(vm, job->source, job->path);
+	stopProfile(vm);
+
+	bluReleaseVM(job->pool, vm);
+
+	return NULL;
+}
+
+// Runs the script [options.jobs] times at once, each run on its own thread and VM.
+static void runJobs(const char* path) {
+	char* source = readFile(path);
+	bluVMPool* pool = bluNewVMPool(options.jobs, NULL);
+	Job* jobs = malloc(sizeof(Job) * options.jobs);
+
+	for (int32_t i = 0; i < options.jobs; i++) {
+		jobs[i].pool = pool;
+		jobs[i].source = source;
+		jobs[i].path = path;
+		pthread_create(&jobs[i].thread, NULL, runJob, &jobs[i]);
+	}
+
+	bluInterpretResult result = INTERPRET_OK;
+
+	for (int32_t i = 0; i < options.jobs; i++) {
+		pthread_join(jobs[i].thread, NULL);
+
+		if (jobs[i].result != INTERPRET_OK) result = jobs[i].result;
+	}
+
+	free(jobs);
+	bluFreeVMPool(pool);
+	free(source);
+
+	exitOnError(result);
 }
 
 static void help() {
 	printf("%s %s\n\n", "blu", BLU_VERSION_STR);
-	printf("Usage: blu [path]\n");
+	printf("Usage: blu [options] [path]\n\n");
+	printf("Options:\n");
+	printf("  -h, --help     Print this help and exit\n");
+	printf("  -v, --version  Print the version and exit\n");
+	printf("  --no-jit       Interpret everything, never compile hot functions to native code\n");
+	printf("  --shared-image Take the core library from a shared image, as embedders hosting many VMs do\n");
+	printf("  --jobs <n>     Run the script n times at once, each run on its own thread and VM\n");
+	printf("  --profile <f>  Sample where the script spends its time and write collapsed stacks to f\n");
+	printf("  --trace-startup\n");
+	printf("                 Print how long each phase of starting the VM and the script took to stderr\n");
+	printf("  --alloc-profile <f>\n");
+	printf("                 Sample which lines allocate and write the bytes allocated on each to f\n");
+	printf("  --trace <f>    Record every call, native and collection and write them to f as Chrome trace events\n");
 }
 
 static void version() {
@@ -72,20 +298,55 @@ static void version() {
 }
 
 int main(int argc, const char* argv[]) {
-	if (argc == 1) {
-		repl();
-	} else if (argc == 2) {
-		if (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
+	const char* path = NULL;
+
+	// Startup is measured from here, whatever happened before main() isn't.
+	markStartup("main");
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
 			help();
-		} else if (strcmp(argv[1], "--version") == 0 || strcmp(argv[1], "-v") == 0) {
+			return 0;
+		} else if (strcmp(argv[i], "--version") == 0 || strcmp(argv[i], "-v") == 0) {
 			version();
+			return 0;
+		} else if (strcmp(argv[i], "--no-jit") == 0) {
+			options.jit = false;
+		} else if (strcmp(argv[i], "--shared-image") == 0) {
+			options.sharedImage = true;
+		} else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+			options.jobs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			options.profile = argv[++i];
+		} else if (strcmp(argv[i], "--trace-startup") == 0) {
+			options.traceStartup = true;
+		} else if (strcmp(argv[i], "--alloc-profile") == 0 && i + 1 < argc) {
+			options.allocationProfile = argv[++i];
+		} else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			options.trace = argv[++i];
+		} else if (argv[i][0] != '-' && path == NULL) {
+			path = argv[i];
 		} else {
-			runFile(argv[1]);
+			help();
+			exit(64);
 		}
+	}
+
+	if (options.profile != NULL) profile = openProfile(options.profile);
+	if (options.allocationProfile != NULL) allocationProfile = openProfile(options.allocationProfile);
+	if (options.trace != NULL) trace = openProfile(options.trace);
+
+	if (path == NULL) {
+		repl();
+	} else if (options.jobs > 1) {
+		runJobs(path);
 	} else {
-		help();
-		exit(64);
+		runFile(path);
 	}
 
+	if (profile != NULL) fclose(profile);
+	if (allocationProfile != NULL) fclose(allocationProfile);
+	if (trace != NULL) fclose(trace);
+
 	return 0;
 }
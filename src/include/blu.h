@@ -28,6 +28,8 @@
 
 typedef struct bluVM bluVM;
 
+typedef struct bluImage bluImage;
+
 typedef struct bluValue bluValue;
 
 typedef struct bluObj bluObj;
@@ -52,10 +54,80 @@ typedef enum {
 	INTERPRET_ASSERTION_ERROR,
 } bluInterpretResult;
 
+// Points in starting a VM and running its first script, in the order they are reached. A VM created from an image skips
+// the core and module phases.
+typedef enum {
+	BLU_STARTUP_CORE_COMPILED,
+	BLU_STARTUP_CORE_NATIVES,
+	BLU_STARTUP_MODULES,
+	BLU_STARTUP_IMAGE_ATTACHED,
+	BLU_STARTUP_SCRIPT_COMPILED,
+	BLU_STARTUP_FIRST_INSTRUCTION,
+} bluStartupPhase;
+
+// Called when a VM reaches [phase] of its startup, [time] is the monotonic clock in nanoseconds.
+typedef void (*bluStartupHook)(bluVM* vm, bluStartupPhase phase, int64_t time, void* data);
+
+typedef struct {
+	// Number of value stack slots and call frames allocated up front. Both stacks grow on demand.
+	int32_t stackSize;
+	int32_t frameSize;
+
+	// Deepest nesting of calls before a stack overflow is reported.
+	int32_t framesMax;
+
+	// Image to take the core library from instead of loading it into the new VM, or NULL.
+	bluImage* image;
+
+	// Bytes of printed output collected before they are written to stdout. Zero writes them at the end of every print, a
+	// negative size buffers OUTPUT_BUFFER_SIZE bytes unless stdout is a terminal.
+	int32_t outputBufferSize;
+
+	// Called with [startupData] as each phase of startup ends, up to the first instruction of the first script, or NULL.
+	bluStartupHook startupHook;
+	void* startupData;
+} bluVMConfig;
+
+// Fills [config] with the defaults used by bluNewVM().
+void bluInitVMConfig(bluVMConfig* config);
+
 bluVM* bluNewVM();
+bluVM* bluNewVMWithConfig(const bluVMConfig* config);
+
+// Loads the core library once, so its classes, compiled code and interned names can be shared by every VM created with
+// the image in its config. A shared class is copied into a VM the first time that VM changes it. The image has to
+// outlive all of these VMs.
+bluImage* bluNewImage();
+void bluFreeImage(bluImage* image);
+
+// Returns a VM created from an image to the state it was created in. Globals, loaded modules and every object of
+// earlier scripts are dropped, while the stacks, tables and the region stay allocated. Returns false, leaving the VM
+// untouched, when it has no image.
+bool bluResetVM(bluVM* vm);
+
+// VMs share nothing but their image, which is never written to. Each VM may be used by one thread at a time, different
+// VMs may run on different threads at once. A pool hands out VMs to threads running independent jobs and resets them
+// when they are returned. All functions of the pool are safe to call from any thread.
+typedef struct bluVMPool bluVMPool;
+
+// Creates a pool with [size] VMs ready to use. [config] may be NULL for the defaults. Without an image in the config the
+// pool loads its own.
+bluVMPool* bluNewVMPool(int32_t size, const bluVMConfig* config);
+
+// Frees the pool and its VMs. Every acquired VM has to be released first.
+void bluFreeVMPool(bluVMPool* pool);
+
+// Takes an idle VM out of the pool, creating a new one when all of them are in use.
+bluVM* bluAcquireVM(bluVMPool* pool);
+
+// Resets [vm] and puts it back into the pool.
+void bluReleaseVM(bluVMPool* pool, bluVM* vm);
 
 void bluFreeVM(bluVM* vm);
 
+// Writes out whatever scripts running in [vm] printed and is still buffered.
+void bluFlushOutput(bluVM* vm);
+
 bluInterpretResult bluInterpret(bluVM* vm, const char* source, const char* name);
 
 bluObj* bluGetGlobal(bluVM* vm, const char* name);
@@ -65,4 +137,76 @@ bool bluDefineStaticMethod(bluVM* vm, bluObj* obj, const char* name, bluNativeFn
 
 void bluRegisterModule(bluVM* vm, const char* name, bluModuleLoader loader);
 
+// Number of object types the statistics of the heap are broken down by, named by bluObjectTypeName().
+#define BLU_OBJECT_TYPES 10
+
+// Pauses of the GC are counted in buckets of up to 0.1 ms, 1 ms, 10 ms, 100 ms, 1 s and longer.
+#define BLU_PAUSE_BUCKETS 6
+
+typedef struct {
+	// Garbage collections run so far, their pauses added up and the longest one, in seconds of wall time.
+	int64_t collections;
+	double totalPause;
+	double maxPause;
+	int64_t pauses[BLU_PAUSE_BUCKETS];
+
+	// Bytes allocated by the VM and the number the next collection starts at.
+	size_t bytesAllocated;
+	size_t nextGC;
+
+	// Objects on the heap and the bytes they take with their buffers, by type. Objects nothing references any more are
+	// counted until the next collection frees them.
+	int64_t objects[BLU_OBJECT_TYPES];
+	size_t objectBytes[BLU_OBJECT_TYPES];
+
+	// Entries and capacity of the table of interned strings and of the globals.
+	int32_t strings;
+	int32_t stringsCapacity;
+	int32_t globals;
+	int32_t globalsCapacity;
+} bluStats;
+
+// Fills [stats] with the state of the heap and the GC of [vm]. Walks the whole heap, so it takes time proportional to
+// the number of objects.
+void bluGetStats(bluVM* vm, bluStats* stats);
+
+// Returns the name of the object type with index [type] in bluStats.
+const char* bluObjectTypeName(int32_t type);
+
+// Returns the name of a startup phase, e.g. "core compiled".
+const char* bluStartupPhaseName(bluStartupPhase phase);
+
+// Writes every object on the heap of [vm], with its size and references, to [path] in the .heapsnapshot format of
+// Chrome, which its DevTools open in the Memory tab. Returns false when the file can't be written.
+bool bluWriteHeapSnapshot(bluVM* vm, const char* path);
+
+// Samples the call stack of [vm] [frequency] times per second of CPU time used by the calling thread, which has to be
+// the one running the VM. A thread profiles one VM at a time. Returns false when sampling could not be started.
+bool bluStartProfiler(bluVM* vm, int32_t frequency);
+
+// Stops sampling [vm] and writes the samples to [file], unless it's NULL, as collapsed stacks: a line for every distinct
+// stack, its frames separated by semicolons followed by the number of samples. flamegraph.pl and speedscope read it.
+void bluStopProfiler(bluVM* vm, FILE* file);
+
+// Samples the objects [vm] allocates, one sample every [interval] bytes, recording the function and the line allocating.
+// Returns false when the VM already samples its allocations.
+bool bluStartAllocationProfiler(bluVM* vm, int64_t interval);
+
+// Stops sampling the allocations of [vm] and writes a line for every place that allocated to [file], unless it's NULL:
+// the function with its line followed by the bytes allocated there, largest first. flamegraph.pl reads it as well.
+void bluStopAllocationProfiler(bluVM* vm, FILE* file);
+
+// Records every call and return of [vm] with the natives it runs and its collections as timed spans, keeping the last
+// [capacity] events in a ring buffer. Tracing can start and stop at any point, functions already running are traced
+// from then on. Returns false when the VM is already being traced.
+bool bluStartTrace(bluVM* vm, int32_t capacity);
+
+// Stops tracing [vm] and writes the events to [file], unless it's NULL, as JSON of the Chrome trace event format, which
+// Perfetto and chrome://tracing show as a timeline. Every fiber gets a track of its own. Ends of functions whose starts
+// the ring buffer dropped are left out, so every end written has its start.
+void bluStopTrace(bluVM* vm, FILE* file);
+
+// Enables or disables compilation of hot functions to native code. Has no effect on platforms without the JIT.
+void bluSetJitEnabled(bluVM* vm, bool enabled);
+
 #endif
@@ -2,3 +2,14 @@
 
 DEFINE_BUFFER(Byte, uint8_t);
 DEFINE_BUFFER(Int, int32_t);
+
+void ByteBufferAppend(ByteBuffer* buffer, const void* bytes, int32_t count) {
+	if (buffer->capacity < buffer->count + count) {
+		int32_t capacity = bluPowerOf2Ceil(buffer->count + count);
+		buffer->data = (uint8_t*)realloc(buffer->data, capacity);
+		buffer->capacity = capacity;
+	}
+
+	memcpy(buffer->data + buffer->count, bytes, count);
+	buffer->count += count;
+}
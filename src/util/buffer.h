@@ -50,4 +50,7 @@
 DECLARE_BUFFER(Byte, uint8_t);
 DECLARE_BUFFER(Int, int32_t);
 
+// Appends [count] bytes at once instead of one by one.
+void ByteBufferAppend(ByteBuffer* buffer, const void* bytes, int32_t count);
+
 #endif
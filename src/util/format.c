@@ -0,0 +1,475 @@
+#include "format.h"
+#include "format_powers.h"
+
+#define DOUBLE_SIGNIFICAND_BITS 52
+#define DOUBLE_HIDDEN_BIT ((uint64_t)1 << DOUBLE_SIGNIFICAND_BITS)
+#define DOUBLE_SIGNIFICAND_MASK (DOUBLE_HIDDEN_BIT - 1)
+#define DOUBLE_EXPONENT_MASK 0x7FF0000000000000u
+#define DOUBLE_EXPONENT_BIAS 1075
+
+static const uint64_t powersOfTen[] = {1u,
+                                       10u,
+                                       100u,
+                                       1000u,
+                                       10000u,
+                                       100000u,
+                                       1000000u,
+                                       10000000u,
+                                       100000000u,
+                                       1000000000u,
+                                       10000000000u,
+                                       100000000000u,
+                                       1000000000000u,
+                                       10000000000000u,
+                                       100000000000000u,
+                                       1000000000000000u,
+                                       10000000000000000u,
+                                       100000000000000000u,
+                                       1000000000000000000u,
+                                       10000000000000000000u};
+
+static uint64_t doubleBits(double number) {
+	uint64_t bits;
+	memcpy(&bits, &number, sizeof(double));
+
+	return bits;
+}
+
+static double bitsDouble(uint64_t bits) {
+	double number;
+	memcpy(&number, &bits, sizeof(double));
+
+	return number;
+}
+
+static int32_t formatInteger(int64_t integer, char* chars) {
+	char digits[24];
+	int32_t count = 0;
+
+	uint64_t magnitude = integer < 0 ? -(uint64_t)integer : (uint64_t)integer;
+
+	do {
+		digits[count++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	int32_t length = 0;
+	if (integer < 0) chars[length++] = '-';
+
+	while (count > 0) {
+		chars[length++] = digits[--count];
+	}
+
+	return length;
+}
+
+// Grisu3 by Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers". It finds the
+// shortest digits which read back as the same double, or reports the about half a percent of numbers it can't be sure
+// about, which are then searched for with snprintf().
+
+// Floating point number f * 2^e with a 64 bit significand.
+typedef struct {
+	uint64_t f;
+	int32_t e;
+} DiyFp;
+
+static DiyFp diyFromDouble(double number) {
+	uint64_t bits = doubleBits(number);
+	int32_t exponent = (int32_t)((bits & DOUBLE_EXPONENT_MASK) >> DOUBLE_SIGNIFICAND_BITS);
+	uint64_t significand = bits & DOUBLE_SIGNIFICAND_MASK;
+
+	if (exponent == 0) return (DiyFp){significand, 1 - DOUBLE_EXPONENT_BIAS};
+
+	return (DiyFp){significand + DOUBLE_HIDDEN_BIT, exponent - DOUBLE_EXPONENT_BIAS};
+}
+
+static DiyFp diyMultiply(DiyFp a, DiyFp b) {
+	unsigned __int128 product = (unsigned __int128)a.f * b.f;
+
+	uint64_t high = (uint64_t)(product >> 64);
+	uint64_t low = (uint64_t)product;
+
+	// Rounded to nearest.
+	return (DiyFp){high + (low >> 63), a.e + b.e + 64};
+}
+
+static DiyFp diyNormalize(DiyFp x) {
+	int32_t shift = __builtin_clzll(x.f);
+
+	return (DiyFp){x.f << shift, x.e - shift};
+}
+
+// Boundaries halfway to the neighbouring doubles, both with the exponent of the normalized upper one.
+static void diyBoundaries(DiyFp v, DiyFp* minus, DiyFp* plus) {
+	DiyFp upper = diyNormalize((DiyFp){(v.f << 1) + 1, v.e - 1});
+
+	// The lower neighbour of a power of two is closer.
+	DiyFp lower = v.f == DOUBLE_HIDDEN_BIT ? (DiyFp){(v.f << 2) - 1, v.e - 2} : (DiyFp){(v.f << 1) - 1, v.e - 1};
+
+	lower.f <<= lower.e - upper.e;
+	lower.e = upper.e;
+
+	*minus = lower;
+	*plus = upper;
+}
+
+// Cached power of ten which scales a number with binary exponent [e] to an exponent in [-60, -32]. Stores the negated
+// decimal exponent of the power in [k].
+static DiyFp cachedPower(int32_t e, int32_t* k) {
+	double dk = (-61 - e) * 0.30102999566398114 + 347;
+	int32_t rounded = (int32_t)dk;
+	if (dk - rounded > 0.0) rounded++;
+
+	int32_t index = (rounded >> 3) + 1;
+	*k = -(-348 + index * 8);
+
+	return (DiyFp){cachedPowers[index].f, cachedPowers[index].e};
+}
+
+// Drops the last digit towards [w] while the digits stay inside the unsafe interval. Fails when the imprecision of
+// the scaled numbers, [unit], leaves it open whether the digits are the closest ones or inside the boundaries at all.
+static bool roundWeed(char* digits, int32_t length, uint64_t distance, uint64_t unsafe, uint64_t rest, uint64_t tenKappa,
+                      uint64_t unit) {
+	uint64_t smallDistance = distance - unit;
+	uint64_t bigDistance = distance + unit;
+
+	while (rest < smallDistance && unsafe - rest >= tenKappa &&
+	       (rest + tenKappa < smallDistance || smallDistance - rest >= rest + tenKappa - smallDistance)) {
+		digits[length - 1]--;
+		rest += tenKappa;
+	}
+
+	if (rest < bigDistance && unsafe - rest >= tenKappa &&
+	    (rest + tenKappa < bigDistance || bigDistance - rest > rest + tenKappa - bigDistance)) {
+		return false;
+	}
+
+	return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+static int32_t countDigits(uint32_t n) {
+	int32_t count = 1;
+	while (count < 10 && n >= powersOfTen[count]) count++;
+
+	return count;
+}
+
+static bool generateDigits(DiyFp lower, DiyFp w, DiyFp upper, char* digits, int32_t* length, int32_t* k) {
+	uint64_t unit = 1;
+
+	DiyFp tooLow = {lower.f - unit, lower.e};
+	DiyFp tooHigh = {upper.f + unit, upper.e};
+	uint64_t unsafe = tooHigh.f - tooLow.f;
+
+	DiyFp one = {(uint64_t)1 << -w.e, w.e};
+
+	uint32_t integral = (uint32_t)(tooHigh.f >> -one.e);
+	uint64_t fractional = tooHigh.f & (one.f - 1);
+
+	*length = 0;
+
+	for (int32_t kappa = countDigits(integral); kappa > 0;) {
+		uint32_t divisor = (uint32_t)powersOfTen[kappa - 1];
+
+		digits[(*length)++] = '0' + integral / divisor;
+		integral %= divisor;
+		kappa--;
+
+		uint64_t rest = ((uint64_t)integral << -one.e) + fractional;
+		if (rest < unsafe) {
+			*k += kappa;
+			return roundWeed(digits, *length, tooHigh.f - w.f, unsafe, rest, (uint64_t)divisor << -one.e, unit);
+		}
+	}
+
+	for (int32_t kappa = 0;;) {
+		fractional *= 10;
+		unit *= 10;
+		unsafe *= 10;
+
+		digits[(*length)++] = '0' + (char)(fractional >> -one.e);
+		fractional &= one.f - 1;
+		kappa--;
+
+		if (fractional < unsafe) {
+			*k += kappa;
+			return roundWeed(digits, *length, (tooHigh.f - w.f) * unit, unsafe, fractional, one.f, unit);
+		}
+	}
+}
+
+// Shortest digits by trying more and more of them, for the few numbers Grisu can't decide. Up to 15 digits every
+// decimal survives the round trip, so the search starts there and drops the trailing zeros.
+static int32_t searchDigits(double number, char* digits, int32_t* k) {
+	char text[NUMBER_FORMAT_MAX];
+
+	for (int32_t precision = 15;; precision++) {
+		snprintf(text, sizeof(text), "%.*e", precision - 1, number);
+
+		char* exponent = strchr(text, 'e');
+
+		double parsed;
+		if (!bluParseNumber(text, (int32_t)strlen(text), &parsed) || parsed != number) {
+			if (precision < 17) continue;
+		}
+
+		int32_t length = 0;
+		for (char* c = text; c < exponent; c++) {
+			if (*c != '.') digits[length++] = *c;
+		}
+
+		while (length > 1 && digits[length - 1] == '0') length--;
+
+		*k = atoi(exponent + 1) - length + 1;
+
+		return length;
+	}
+}
+
+// Writes the digits of positive, finite [number] and returns their count. The number is digits * 10^k.
+static int32_t grisu3(double number, char* digits, int32_t* k) {
+	DiyFp v = diyFromDouble(number);
+
+	DiyFp minus;
+	DiyFp plus;
+	diyBoundaries(v, &minus, &plus);
+
+	DiyFp power = cachedPower(plus.e, k);
+
+	DiyFp w = diyMultiply(diyNormalize(v), power);
+	DiyFp upper = diyMultiply(plus, power);
+	DiyFp lower = diyMultiply(minus, power);
+
+	int32_t length;
+	if (generateDigits(lower, w, upper, digits, &length, k)) return length;
+
+	return searchDigits(number, digits, k);
+}
+
+static int32_t formatExponent(int32_t exponent, char* chars) {
+	int32_t length = 0;
+
+	chars[length++] = 'e';
+	chars[length++] = exponent < 0 ? '-' : '+';
+
+	return length + formatInteger(exponent < 0 ? -exponent : exponent, chars + length);
+}
+
+// Lays the digits out like JavaScript does: plain up to 21 integer digits and down to 6 leading zeros of a fraction,
+// with an exponent otherwise.
+static int32_t layOut(const char* digits, int32_t count, int32_t k, char* chars) {
+	// The number is 0.digits * 10^point.
+	int32_t point = count + k;
+
+	if (k >= 0 && point <= 21) {
+		memcpy(chars, digits, count);
+		memset(chars + count, '0', k);
+		return point;
+	}
+
+	if (point > 0 && point <= 21) {
+		memcpy(chars, digits, point);
+		chars[point] = '.';
+		memcpy(chars + point + 1, digits + point, count - point);
+		return count + 1;
+	}
+
+	if (point > -6 && point <= 0) {
+		chars[0] = '0';
+		chars[1] = '.';
+		memset(chars + 2, '0', -point);
+		memcpy(chars + 2 - point, digits, count);
+		return count + 2 - point;
+	}
+
+	int32_t length = 0;
+	chars[length++] = digits[0];
+
+	if (count > 1) {
+		chars[length++] = '.';
+		memcpy(chars + length, digits + 1, count - 1);
+		length += count - 1;
+	}
+
+	return length + formatExponent(point - 1, chars + length);
+}
+
+int32_t bluFormatNumber(double number, char* chars) {
+	// Whole numbers are most of what gets printed, they don't need the general routine.
+	if (number > -9007199254740992.0 && number < 9007199254740992.0 && number == (int64_t)number) {
+		return formatInteger((int64_t)number, chars);
+	}
+
+	if (isnan(number)) {
+		memcpy(chars, "nan", 3);
+		return 3;
+	}
+
+	int32_t length = 0;
+	if (signbit(number)) {
+		chars[length++] = '-';
+		number = -number;
+	}
+
+	if (isinf(number)) {
+		memcpy(chars + length, "inf", 3);
+		return length + 3;
+	}
+
+	char digits[20];
+	int32_t k = 0;
+	int32_t count = grisu3(number, digits, &k);
+
+	return length + layOut(digits, count, k, chars + length);
+}
+
+// Parsing uses the fast path of Clinger when the digits and the power of ten are both exact doubles, the algorithm of
+// Eisel and Lemire, as described in "Number Parsing at a Gigabyte per Second", for everything else with up to 19
+// significant digits, and strtod() for longer numbers.
+
+static const double exactPowersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Returns digits * 10^exponent rounded to the nearest double.
+static double eiselLemire(uint64_t digits, int32_t exponent) {
+	if (digits == 0 || exponent < POWER_OF_FIVE_MIN) return 0.0;
+	if (exponent > POWER_OF_FIVE_MAX) return INFINITY;
+
+	int32_t zeros = __builtin_clzll(digits);
+	digits <<= zeros;
+
+	const uint64_t* power = powersOfFive[exponent - POWER_OF_FIVE_MIN];
+
+	// Enough of the product to round correctly, the second half of the power is only needed when the bits below the
+	// significand could carry into it.
+	unsigned __int128 product = (unsigned __int128)digits * power[0];
+	uint64_t high = (uint64_t)(product >> 64);
+	uint64_t low = (uint64_t)product;
+
+	if ((high & 0x1FF) == 0x1FF) {
+		uint64_t carry = (uint64_t)(((unsigned __int128)digits * power[1]) >> 64);
+
+		low += carry;
+		if (carry > low) high++;
+	}
+
+	int32_t upperBit = (int32_t)(high >> 63);
+	uint64_t significand = high >> (upperBit + 64 - DOUBLE_SIGNIFICAND_BITS - 3);
+
+	// floor(exponent * log2(10)) + 63, biased.
+	int32_t binaryExponent = (((152170 + 65536) * exponent) >> 16) + 63 + upperBit - zeros + 1023;
+
+	if (binaryExponent <= 0) {
+		// Subnormal, or too small even for that.
+		if (-binaryExponent + 1 >= 64) return 0.0;
+
+		significand >>= -binaryExponent + 1;
+		significand += significand & 1;
+		significand >>= 1;
+
+		binaryExponent = significand < DOUBLE_HIDDEN_BIT ? 0 : 1;
+
+		return bitsDouble((significand & DOUBLE_SIGNIFICAND_MASK) | ((uint64_t)binaryExponent << DOUBLE_SIGNIFICAND_BITS));
+	}
+
+	// Exactly halfway between two doubles, which only happens for small powers, rounds to even.
+	if (low <= 1 && exponent >= -4 && exponent <= 23 && (significand & 3) == 1 &&
+	    (significand << (upperBit + 64 - DOUBLE_SIGNIFICAND_BITS - 3)) == high) {
+		significand &= ~(uint64_t)1;
+	}
+
+	significand += significand & 1;
+	significand >>= 1;
+
+	if (significand >= (DOUBLE_HIDDEN_BIT << 1)) {
+		significand = DOUBLE_HIDDEN_BIT;
+		binaryExponent++;
+	}
+
+	if (binaryExponent >= 0x7FF) return INFINITY;
+
+	return bitsDouble((significand & DOUBLE_SIGNIFICAND_MASK) | ((uint64_t)binaryExponent << DOUBLE_SIGNIFICAND_BITS));
+}
+
+bool bluParseNumber(const char* chars, int32_t length, double* number) {
+	const char* current = chars;
+	const char* end = chars + length;
+
+	bool negative = current < end && *current == '-';
+	if (current < end && (*current == '-' || *current == '+')) current++;
+
+	uint64_t digits = 0;
+	int32_t significant = 0;
+	int32_t exponent = 0;
+	bool anyDigit = false;
+
+	// Up to 19 significant digits fit into [digits], the rest only move the decimal point.
+	for (; current < end && *current >= '0' && *current <= '9'; current++) {
+		anyDigit = true;
+
+		if (significant < 19) {
+			digits = digits * 10 + (*current - '0');
+			if (digits != 0) significant++;
+		} else {
+			exponent++;
+			if (*current != '0') significant++;
+		}
+	}
+
+	if (current < end && *current == '.') {
+		current++;
+
+		for (; current < end && *current >= '0' && *current <= '9'; current++) {
+			anyDigit = true;
+
+			if (significant < 19) {
+				digits = digits * 10 + (*current - '0');
+				exponent--;
+				if (digits != 0) significant++;
+			} else if (*current != '0') {
+				significant++;
+			}
+		}
+	}
+
+	if (!anyDigit) return false;
+
+	if (current < end && (*current == 'e' || *current == 'E')) {
+		current++;
+
+		bool negativeExponent = current < end && *current == '-';
+		if (current < end && (*current == '-' || *current == '+')) current++;
+
+		if (current == end || *current < '0' || *current > '9') return false;
+
+		int32_t written = 0;
+		for (; current < end && *current >= '0' && *current <= '9'; current++) {
+			// Anything this large is zero or infinity already.
+			if (written < 100000) written = written * 10 + (*current - '0');
+		}
+
+		exponent += negativeExponent ? -written : written;
+	}
+
+	if (current != end) return false;
+
+	double value;
+
+	if (significant > 19) {
+		// Rounding would depend on the digits that were dropped.
+		char* copy = malloc(length + 1);
+		memcpy(copy, chars, length);
+		copy[length] = '\0';
+
+		value = fabs(strtod(copy, NULL));
+		free(copy);
+	} else if (digits <= ((uint64_t)1 << 53) && exponent >= -22 && exponent <= 22) {
+		value = exponent < 0 ? (double)digits / exactPowersOfTen[-exponent] : (double)digits * exactPowersOfTen[exponent];
+	} else {
+		value = eiselLemire(digits, exponent);
+	}
+
+	*number = negative ? -value : value;
+
+	return true;
+}
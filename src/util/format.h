@@ -0,0 +1,16 @@
+#ifndef blu_format_h
+#define blu_format_h
+
+#include "include/blu.h"
+
+// Longest text bluFormatNumber() writes, without a terminating zero.
+#define NUMBER_FORMAT_MAX 32
+
+// Writes the shortest digits which read back as [number] to [chars] and returns their length. Nothing is terminated.
+int32_t bluFormatNumber(double number, char* chars);
+
+// Parses all [length] characters of [chars] as a decimal number, with an optional sign, fraction and exponent, into
+// [number]. Returns false when they are not one.
+bool bluParseNumber(const char* chars, int32_t length, double* number);
+
+#endif
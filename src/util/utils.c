@@ -12,3 +12,17 @@ int64_t bluPowerOf2Ceil(int64_t n) {
 
 	return n;
 }
+
+int64_t bluMonotonicTime() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+double bluThreadClock() {
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
@@ -5,4 +5,10 @@
 
 int64_t bluPowerOf2Ceil(int64_t n);
 
+// CPU time used by the calling thread, in seconds. Unlike clock() it doesn't count VMs running on other threads.
+double bluThreadClock();
+
+// Monotonic wall clock time in nanoseconds, unaffected by changes of the system time.
+int64_t bluMonotonicTime();
+
 #endif
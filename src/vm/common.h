@@ -5,11 +5,34 @@
 
 #define LOCALS_MAX UINT16_MAX - 1
 
+// Compile with -D BLU_REGISTER_VM to make the compiler emit register operand (*_RK) instructions. These fuse the loads
+// of the operands of a binary operation into it when both are locals or constants, reading them straight from frame
+// slots and constants. The result is still pushed on the stack. Without the JIT, scripts/bench_vm.sh measured a third
+// fewer instructions and 17% less time on fibonacci, but a sixth fewer instructions and no measurable difference on
+// binarytrees, whose time goes to allocation.
+// #define BLU_REGISTER_VM
+
+// Compile with -D BLU_COUNT_INSTRUCTIONS to count dispatched instructions and report them when the VM is freed. Like
+// BLU_OPSTATS, these builds interpret everything.
+// #define BLU_COUNT_INSTRUCTIONS
+
+// Compile with -D BLU_OPSTATS to count how often every instruction and every pair of consecutive instructions run. The
+// counts are printed when the VM is freed and System.opStats() returns them. Native code of the JIT would bypass the
+// counters, so these builds interpret everything.
+// #define BLU_OPSTATS
+
+// Hot functions are compiled to native code on x86-64. Compile with -D BLU_NO_JIT to leave them to the interpreter.
+#if defined(__x86_64__) && !defined(BLU_NO_JIT) && !defined(BLU_OPSTATS) && !defined(BLU_COUNT_INSTRUCTIONS)
+#define BLU_JIT
+#endif
+
 #ifdef DEBUG
 // #define DEBUG_COMPILER_DISASSEMBLE
 // #define DEBUG_VM_TRACE
 #define DEBUG_GC_STRESS
 // #define DEBUG_GC_TRACE
+#define DEBUG_JIT_STRESS
+#define DEBUG_STACK_STRESS
 #endif
 
 #endif
@@ -1,5 +1,7 @@
 #include "chunk.h"
 
+#include "vm/object.h"
+
 DEFINE_BUFFER(bluValue, bluValue);
 
 void bluChunkInit(bluChunk* chunk) {
@@ -9,6 +11,7 @@ void bluChunkInit(bluChunk* chunk) {
 	ByteBufferInit(&chunk->code);
 	IntBufferInit(&chunk->lines);
 	IntBufferInit(&chunk->columns);
+	ByteBufferInit(&chunk->feedback);
 
 	bluValueBufferInit(&chunk->constants);
 }
@@ -17,6 +20,7 @@ void bluChunkFree(bluChunk* chunk) {
 	ByteBufferFree(&chunk->code);
 	IntBufferFree(&chunk->lines);
 	IntBufferFree(&chunk->columns);
+	ByteBufferFree(&chunk->feedback);
 
 	bluValueBufferFree(&chunk->constants);
 }
@@ -25,4 +29,76 @@ void bluChunkWrite(bluChunk* chunk, uint8_t byte, int32_t line, int32_t column)
 	ByteBufferWrite(&chunk->code, byte);
 	IntBufferWrite(&chunk->lines, line);
 	IntBufferWrite(&chunk->columns, column);
+	ByteBufferWrite(&chunk->feedback, 0);
+}
+
+int32_t bluInstructionLength(bluChunk* chunk, int32_t offset) {
+	switch (chunk->code.data[offset]) {
+	case OP_FALSE:
+	case OP_NIL:
+	case OP_TRUE:
+	case OP_POP:
+	case OP_SUBSCRIPT_GET:
+	case OP_SUBSCRIPT_SET:
+	case OP_EQUAL:
+	case OP_NOT_EQUAL:
+	case OP_GREATER:
+	case OP_GREATER_EQUAL:
+	case OP_LESS:
+	case OP_LESS_EQUAL:
+	case OP_ADD:
+	case OP_DIVIDE:
+	case OP_REMINDER:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_POWER:
+	case OP_NOT:
+	case OP_NEGATE:
+	case OP_GREATER_NUM:
+	case OP_GREATER_EQUAL_NUM:
+	case OP_LESS_NUM:
+	case OP_LESS_EQUAL_NUM:
+	case OP_ADD_NUM:
+	case OP_ADD_STR:
+	case OP_DIVIDE_NUM:
+	case OP_SUBTRACT_NUM:
+	case OP_MULTIPLY_NUM:
+	case OP_CLOSE_OPVALUE:
+	case OP_INHERIT:
+	case OP_ECHO:
+	case OP_RETURN:
+	case OP_ASSERT: return 1;
+
+	case OP_CALL:
+	case OP_CALL_REGION:
+	case OP_TAIL_CALL: return 2;
+
+	case OP_INVOKE:
+	case OP_INVOKE_REGION:
+	case OP_SUPER: return 4;
+
+	case OP_EQUAL_RK:
+	case OP_NOT_EQUAL_RK:
+	case OP_GREATER_RK:
+	case OP_GREATER_EQUAL_RK:
+	case OP_LESS_RK:
+	case OP_LESS_EQUAL_RK:
+	case OP_ADD_RK:
+	case OP_DIVIDE_RK:
+	case OP_REMINDER_RK:
+	case OP_SUBTRACT_RK:
+	case OP_MULTIPLY_RK:
+	case OP_POWER_RK: return 5;
+
+	case OP_CLOSURE:
+	case OP_CLOSURE_REGION: {
+		uint16_t constant = (uint16_t)((chunk->code.data[offset + 1] << 8) | chunk->code.data[offset + 2]);
+		bluObjFunction* function = AS_FUNCTION(chunk->constants.data[constant]);
+
+		// Each upvalue is described by a byte and a short.
+		return 3 + function->upvalueCount * 3;
+	}
+
+	default: return 3;
+	}
 }
@@ -5,6 +5,10 @@
 #include "vm/compiler/opcode.h"
 #include "vm/value.h"
 
+// Operand types seen by an instruction, collected by the VM to quicken it.
+#define FEEDBACK_NUMBER 0x1
+#define FEEDBACK_STRING 0x2
+
 DECLARE_BUFFER(bluValue, bluValue);
 
 typedef struct {
@@ -15,6 +19,9 @@ typedef struct {
 	IntBuffer lines;
 	IntBuffer columns;
 
+	// Type feedback for each byte of the code.
+	ByteBuffer feedback;
+
 	bluValueBuffer constants;
 } bluChunk;
 
@@ -23,4 +30,7 @@ void bluChunkFree(bluChunk* chunk);
 
 void bluChunkWrite(bluChunk* chunk, uint8_t byte, int32_t line, int32_t column);
 
+// Returns the length in bytes of the instruction at [offset], with its operands.
+int32_t bluInstructionLength(bluChunk* chunk, int32_t offset);
+
 #endif
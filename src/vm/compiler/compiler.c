@@ -227,6 +227,33 @@ static void emitReturn(bluCompiler* compiler) {
 	emitByte(compiler, OP_RETURN);
 }
 
+// Remembers the instruction starting at [start], which has just been emitted, as an allocation which could be moved to
+// a region.
+static void markAllocation(bluCompiler* compiler, int32_t start) {
+	compiler->allocation = start;
+	compiler->allocationEnd = compiler->function->chunk.code.count;
+}
+
+// Returns the offset of the allocation which produced the value of the expression just compiled, or -1 if the last
+// instruction wasn't an allocation.
+static int32_t lastAllocation(bluCompiler* compiler) {
+	if (compiler->allocationEnd != compiler->function->chunk.code.count) return -1;
+
+	return compiler->allocation;
+}
+
+// Rewrites the allocation at [offset] to allocate its object in the region of the current frame.
+static void regionAllocation(bluCompiler* compiler, int32_t offset) {
+	uint8_t* code = compiler->function->chunk.code.data;
+
+	switch (code[offset]) {
+	case OP_ARRAY: code[offset] = OP_ARRAY_REGION; break;
+	case OP_CLOSURE: code[offset] = OP_CLOSURE_REGION; break;
+	case OP_GET_PROPERTY: code[offset] = OP_GET_PROPERTY_REGION; break;
+	default: __builtin_unreachable();
+	}
+}
+
 static bool identifiersEqual(bluToken* a, bluToken* b) {
 	if (a->length != b->length) return false;
 
@@ -256,12 +283,81 @@ static void declaration(bluCompiler* compiler);
 static void statement(bluCompiler* compiler);
 static void expression(bluCompiler* compiler);
 
+#ifdef BLU_REGISTER_VM
+// Returns the register operand addressing the value loaded by the instructions in [from, to), or -1 when they are not a
+// single local or constant load.
+static int32_t registerOperand(bluCompiler* compiler, int32_t from, int32_t to) {
+	bluChunk* chunk = &compiler->function->chunk;
+
+	// Both loads are exactly 3 bytes long.
+	if (to - from != 3) return -1;
+
+	uint16_t operand = (uint16_t)((chunk->code.data[from + 1] << 8) | chunk->code.data[from + 2]);
+	if (operand > RK_MAX) return -1;
+
+	switch (chunk->code.data[from]) {
+	case OP_GET_LOCAL: return operand;
+	case OP_CONSTANT: return operand | RK_CONSTANT;
+	default: return -1;
+	}
+}
+
+// Replaces the loads of both operands of a binary operator with a single register operand instruction. Returns false
+// when either of the operands is not a plain local or constant load.
+static bool registerBinary(bluCompiler* compiler, bluOpCode opCode, int32_t leftStart, int32_t rightStart) {
+	bluChunk* chunk = &compiler->function->chunk;
+
+	int32_t left = registerOperand(compiler, leftStart, rightStart);
+	int32_t right = registerOperand(compiler, rightStart, chunk->code.count);
+
+	if (left == -1 || right == -1) return false;
+
+	chunk->code.count = leftStart;
+	chunk->lines.count = leftStart;
+	chunk->columns.count = leftStart;
+	chunk->feedback.count = leftStart;
+
+	emitByte(compiler, opCode);
+	emitShort(compiler, (uint16_t)left);
+	emitShort(compiler, (uint16_t)right);
+
+	return true;
+}
+#endif
+
 static void binary(bluCompiler* compiler, bool canAssign) {
 	bluTokenType operatorType = compiler->parser->previous.type;
 
+#ifdef BLU_REGISTER_VM
+	int32_t leftStart = compiler->operandStart;
+	int32_t rightStart = compiler->function->chunk.code.count;
+#endif
+
 	ParseRule* rule = getRule(operatorType);
 	parsePrecedence(compiler, (Precedence)(rule->precedence + 1));
 
+#ifdef BLU_REGISTER_VM
+	bluOpCode registerOp;
+
+	switch (operatorType) {
+	case TOKEN_EQUAL_EQUAL: registerOp = OP_EQUAL_RK; break;
+	case TOKEN_BANG_EQUAL: registerOp = OP_NOT_EQUAL_RK; break;
+	case TOKEN_GREATER: registerOp = OP_GREATER_RK; break;
+	case TOKEN_GREATER_EQUAL: registerOp = OP_GREATER_EQUAL_RK; break;
+	case TOKEN_LESS: registerOp = OP_LESS_RK; break;
+	case TOKEN_LESS_EQUAL: registerOp = OP_LESS_EQUAL_RK; break;
+	case TOKEN_MINUS: registerOp = OP_SUBTRACT_RK; break;
+	case TOKEN_PERCENT: registerOp = OP_REMINDER_RK; break;
+	case TOKEN_PLUS: registerOp = OP_ADD_RK; break;
+	case TOKEN_SLASH: registerOp = OP_DIVIDE_RK; break;
+	case TOKEN_STAR: registerOp = OP_MULTIPLY_RK; break;
+	case TOKEN_CARET: registerOp = OP_POWER_RK; break;
+	default: return;
+	}
+
+	if (registerBinary(compiler, registerOp, leftStart, rightStart)) return;
+#endif
+
 	switch (operatorType) {
 	case TOKEN_EQUAL_EQUAL: emitByte(compiler, OP_EQUAL); break;
 	case TOKEN_BANG_EQUAL: emitByte(compiler, OP_NOT_EQUAL); break;
@@ -388,6 +484,11 @@ static void namedVariable(bluCompiler* compiler, bluToken name, bool canAssign)
 	} else {
 		emitByte(compiler, getOp);
 		emitShort(compiler, (uint16_t)arg);
+
+		// Calling or subscripting a value doesn't let it escape, anything else might.
+		if (getOp == OP_GET_LOCAL && !check(compiler, TOKEN_LEFT_PAREN) && !check(compiler, TOKEN_LEFT_BRACKET)) {
+			compiler->locals.data[arg].escapes = true;
+		}
 	}
 }
 
@@ -438,14 +539,24 @@ static void or (bluCompiler * compiler, bool canAssign) {
 	patchJump(compiler, endJump);
 }
 
-static uint8_t argumentList(bluCompiler* compiler) {
+// Compiles the arguments of a call. When [regionArguments] is not NULL, function literals passed directly as arguments
+// are allocated in the region and [regionArguments] is set if there were any.
+static uint8_t argumentList(bluCompiler* compiler, bool* regionArguments) {
 	uint8_t argCount = 0;
 
 	if (!check(compiler, TOKEN_RIGHT_PAREN)) {
 		do {
+			bool isFunction = check(compiler, TOKEN_FN);
+
 			expression(compiler);
 			argCount++;
 
+			int32_t allocation = lastAllocation(compiler);
+			if (regionArguments != NULL && isFunction && allocation != -1) {
+				regionAllocation(compiler, allocation);
+				*regionArguments = true;
+			}
+
 			if (argCount > 16) {
 				error(compiler, "Cannot have more than 16 arguments.");
 			}
@@ -458,8 +569,10 @@ static uint8_t argumentList(bluCompiler* compiler) {
 }
 
 static void call(bluCompiler* compiler, bool canAssign) {
-	uint8_t argCount = argumentList(compiler);
-	emitBytes(compiler, OP_CALL, argCount);
+	bool regionArguments = false;
+	uint8_t argCount = argumentList(compiler, &regionArguments);
+	emitBytes(compiler, regionArguments ? OP_CALL_REGION : OP_CALL, argCount);
+	compiler->callEnd = compiler->function->chunk.code.count;
 }
 
 static void dot(bluCompiler* compiler, bool canAssign) {
@@ -471,12 +584,15 @@ static void dot(bluCompiler* compiler, bool canAssign) {
 		emitByte(compiler, OP_SET_PROPERTY);
 		emitShort(compiler, name);
 	} else if (match(compiler, TOKEN_LEFT_PAREN)) {
-		uint8_t argCount = argumentList(compiler);
-		emitBytes(compiler, OP_INVOKE, argCount);
+		bool regionArguments = false;
+		uint8_t argCount = argumentList(compiler, &regionArguments);
+		emitBytes(compiler, regionArguments ? OP_INVOKE_REGION : OP_INVOKE, argCount);
 		emitShort(compiler, name);
 	} else {
+		int32_t start = compiler->function->chunk.code.count;
 		emitByte(compiler, OP_GET_PROPERTY);
 		emitShort(compiler, name);
+		markAllocation(compiler, start);
 	}
 }
 
@@ -508,7 +624,7 @@ static void caret(bluCompiler* compiler, bool canAssign) {
 	if (match(compiler, TOKEN_LEFT_PAREN)) {
 		namedVariable(compiler, syntheticToken(compiler, "@"), false);
 
-		uint8_t argCount = argumentList(compiler);
+		uint8_t argCount = argumentList(compiler, NULL);
 
 		pushSuperclass(compiler);
 		emitBytes(compiler, OP_SUPER, argCount);
@@ -523,7 +639,7 @@ static void caret(bluCompiler* compiler, bool canAssign) {
 	namedVariable(compiler, syntheticToken(compiler, "@"), false);
 
 	if (match(compiler, TOKEN_LEFT_PAREN)) {
-		uint8_t argCount = argumentList(compiler);
+		uint8_t argCount = argumentList(compiler, NULL);
 
 		pushSuperclass(compiler);
 		emitBytes(compiler, OP_SUPER, argCount);
@@ -554,8 +670,10 @@ static void array(bluCompiler* compiler, bool canAssign) {
 
 	consume(compiler, TOKEN_RIGHT_BRACKET, "Expect ']' after array.");
 
+	int32_t start = compiler->function->chunk.code.count;
 	emitByte(compiler, OP_ARRAY);
 	emitShort(compiler, len);
+	markAllocation(compiler, start);
 }
 
 static void subscript(bluCompiler* compiler, bool canAssign) {
@@ -641,12 +759,16 @@ static void parsePrecedence(bluCompiler* compiler, Precedence precedence) {
 		return;
 	}
 
+	int32_t operandStart = compiler->function->chunk.code.count;
+
 	bool canAssign = precedence <= PREC_ASSIGNMENT;
 	prefixRule(compiler, canAssign);
 
 	while (precedence <= getRule(compiler->parser->current.type)->precedence) {
 		advance(compiler);
 
+		compiler->operandStart = operandStart;
+
 		ParseFn infixRule = getRule(compiler->parser->previous.type)->infix;
 		infixRule(compiler, canAssign);
 	}
@@ -678,10 +800,15 @@ static void endScope(bluCompiler* compiler) {
 
 	while (compiler->locals.count > 0 &&
 		   compiler->locals.data[compiler->locals.count - 1].depth > compiler->scopeDepth) {
-		if (compiler->locals.data[compiler->locals.count - 1].isUpvalue) {
+		bluLocal* local = &compiler->locals.data[compiler->locals.count - 1];
+
+		if (local->isUpvalue) {
 			emitByte(compiler, OP_CLOSE_OPVALUE);
 		} else {
 			emitByte(compiler, OP_POP);
+
+			// The variable is gone and its initial value never escaped it, so it can't outlive the frame.
+			if (local->allocation != -1 && !local->escapes) regionAllocation(compiler, local->allocation);
 		}
 
 		compiler->locals.count--;
@@ -851,6 +978,13 @@ static void returnStatement(bluCompiler* compiler) {
 		}
 
 		expression(compiler);
+
+		// The result of a call in return position is the result of this function, so the callee can reuse its frame.
+		// OP_RETURN is still emitted for callees which are not closures and therefore return right away.
+		uint8_t* code = compiler->function->chunk.code.data;
+		int32_t end = compiler->function->chunk.code.count;
+		if (compiler->callEnd == end && code[end - 2] == OP_CALL) code[end - 2] = OP_TAIL_CALL;
+
 		emitByte(compiler, OP_RETURN);
 
 		if (needsNewline) expectNewlineOrSemicolon(compiler);
@@ -893,6 +1027,8 @@ static void addLocal(bluCompiler* compiler, bluToken name) {
 	local.name = name;
 	local.depth = -1;
 	local.isUpvalue = false;
+	local.escapes = false;
+	local.allocation = -1;
 
 	bluLocalBufferWrite(&compiler->locals, local);
 }
@@ -945,6 +1081,10 @@ static void varDeclaration(bluCompiler* compiler) {
 
 	if (match(compiler, TOKEN_EQUAL)) {
 		expression(compiler);
+
+		if (compiler->scopeDepth > 0) {
+			compiler->locals.data[compiler->locals.count - 1].allocation = lastAllocation(compiler);
+		}
 	} else {
 		emitByte(compiler, OP_NIL);
 	}
@@ -999,7 +1139,14 @@ static void function(bluCompiler* compiler, bluFunctionType type) {
 	bluDisassembleChunk(&function->chunk);
 #endif
 
+	for (int32_t i = 0; i < function->arity && i < 8; i++) {
+		// Slot zero holds the function or the receiver, the parameters follow.
+		bluLocal* parameter = &fnCompiler.locals.data[i + 1];
+		if (parameter->escapes || parameter->isUpvalue) function->escapingParameters |= 1 << i;
+	}
+
 	// Capture the upvalues in the new closure object.
+	int32_t start = compiler->function->chunk.code.count;
 	emitByte(compiler, OP_CLOSURE);
 	emitShort(compiler, makeConstant(compiler, OBJ_VAL(function)));
 
@@ -1009,6 +1156,8 @@ static void function(bluCompiler* compiler, bluFunctionType type) {
 		emitShort(compiler, fnCompiler.upvalues.data[i].index);
 	}
 
+	markAllocation(compiler, start);
+
 	freeCompiler(&fnCompiler);
 }
 
@@ -1018,6 +1167,10 @@ static void fnDeclaration(bluCompiler* compiler) {
 
 	function(compiler, TYPE_FUNCTION);
 
+	if (compiler->scopeDepth > 0) {
+		compiler->locals.data[compiler->locals.count - 1].allocation = lastAllocation(compiler);
+	}
+
 	defineVariable(compiler, name);
 }
 
@@ -1179,6 +1332,11 @@ static void initCompiler(bluCompiler* compiler, bluCompiler* enclosing, int8_t s
 	compiler->hadError = false;
 	compiler->panicMode = false;
 
+	compiler->operandStart = 0;
+	compiler->allocation = -1;
+	compiler->allocationEnd = -1;
+	compiler->callEnd = -1;
+
 	bluLocalBufferInit(&compiler->locals);
 	bluUpvalueBufferInit(&compiler->upvalues);
 
@@ -1202,6 +1360,8 @@ static void initCompiler(bluCompiler* compiler, bluCompiler* enclosing, int8_t s
 	bluLocal local;
 	local.depth = compiler->scopeDepth;
 	local.isUpvalue = false;
+	local.escapes = false;
+	local.allocation = -1;
 
 	if (type == TYPE_METHOD || type == TYPE_INITIALIZER) {
 		// In a method, it holds the receiver, "@".
@@ -1216,6 +1376,118 @@ static void initCompiler(bluCompiler* compiler, bluCompiler* enclosing, int8_t s
 	bluLocalBufferWrite(&compiler->locals, local);
 }
 
+// Returns the number of values the instruction at [offset] leaves on the stack minus the number it takes from it.
+static int32_t stackEffect(bluChunk* chunk, int32_t offset) {
+	uint8_t* code = chunk->code.data;
+
+	switch (code[offset]) {
+	case OP_CONSTANT:
+	case OP_FALSE:
+	case OP_NIL:
+	case OP_TRUE:
+	case OP_GET_LOCAL:
+	case OP_GET_GLOBAL:
+	case OP_GET_UPVALUE:
+	case OP_EQUAL_RK:
+	case OP_NOT_EQUAL_RK:
+	case OP_GREATER_RK:
+	case OP_GREATER_EQUAL_RK:
+	case OP_LESS_RK:
+	case OP_LESS_EQUAL_RK:
+	case OP_ADD_RK:
+	case OP_DIVIDE_RK:
+	case OP_REMINDER_RK:
+	case OP_SUBTRACT_RK:
+	case OP_MULTIPLY_RK:
+	case OP_POWER_RK:
+	case OP_CLOSURE:
+	case OP_CLOSURE_REGION:
+	case OP_CLASS: return 1;
+
+	case OP_ARRAY:
+	case OP_ARRAY_REGION: return 1 - ((code[offset + 1] << 8) | code[offset + 2]);
+
+	case OP_POP:
+	case OP_DEFINE_GLOBAL:
+	case OP_SET_PROPERTY:
+	case OP_GET_SUPER:
+	case OP_SUBSCRIPT_GET:
+	case OP_EQUAL:
+	case OP_NOT_EQUAL:
+	case OP_GREATER:
+	case OP_GREATER_EQUAL:
+	case OP_LESS:
+	case OP_LESS_EQUAL:
+	case OP_ADD:
+	case OP_DIVIDE:
+	case OP_REMINDER:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_POWER:
+	case OP_GREATER_NUM:
+	case OP_GREATER_EQUAL_NUM:
+	case OP_LESS_NUM:
+	case OP_LESS_EQUAL_NUM:
+	case OP_ADD_NUM:
+	case OP_ADD_STR:
+	case OP_DIVIDE_NUM:
+	case OP_SUBTRACT_NUM:
+	case OP_MULTIPLY_NUM:
+	case OP_CLOSE_OPVALUE:
+	case OP_INHERIT:
+	case OP_METHOD_FOREIGN:
+	case OP_ECHO:
+	case OP_RETURN:
+	case OP_ASSERT: return -1;
+
+	case OP_SUBSCRIPT_SET:
+	case OP_METHOD:
+	case OP_METHOD_STATIC: return -2;
+
+	// The result takes the place of the callee.
+	case OP_CALL:
+	case OP_CALL_REGION:
+	case OP_TAIL_CALL:
+	case OP_INVOKE:
+	case OP_INVOKE_REGION: return -code[offset + 1];
+	case OP_SUPER: return -code[offset + 1] - 1;
+
+	default: return 0;
+	}
+}
+
+// Sets the slot count of the function to the deepest its stack gets. Code is followed in order, which reaches every
+// instruction but the targets of forward jumps, whose depth is taken from the jumps. Where the two differ, e.g. after
+// a branch of a conditional, the larger is kept, which can only overestimate.
+static void countSlots(bluCompiler* compiler) {
+	bluChunk* chunk = &compiler->function->chunk;
+
+	// Depth at the target of every forward jump seen so far, 0 where there is none.
+	int32_t* targets = calloc(chunk->code.count + 1, sizeof(int32_t));
+
+	// The callee, or the receiver, and the parameters.
+	int32_t depth = compiler->function->arity + 1;
+	int32_t slotCount = depth;
+
+	for (int32_t offset = 0; offset < chunk->code.count; offset += bluInstructionLength(chunk, offset)) {
+		if (targets[offset] > depth) depth = targets[offset];
+
+		depth += stackEffect(chunk, offset);
+		if (depth > slotCount) slotCount = depth;
+
+		uint8_t instruction = chunk->code.data[offset];
+		if (instruction == OP_JUMP || instruction == OP_JUMP_IF_FALSE || instruction == OP_JUMP_IF_TRUE) {
+			int32_t target = offset + 3 + ((chunk->code.data[offset + 1] << 8) | chunk->code.data[offset + 2]);
+
+			if (target <= chunk->code.count && targets[target] < depth) targets[target] = depth;
+		}
+	}
+
+	free(targets);
+
+	compiler->function->slotCount = slotCount;
+}
+
 static bluObjFunction* endCompiler(bluCompiler* compiler) {
 	if (compiler->function->chunk.code.count == 0) {
 		// We need to emit return when chunk is empty.
@@ -1225,6 +1497,8 @@ static bluObjFunction* endCompiler(bluCompiler* compiler) {
 		emitReturn(compiler);
 	}
 
+	countSlots(compiler);
+
 	return compiler->function;
 }
 
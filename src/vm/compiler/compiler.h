@@ -13,6 +13,12 @@ typedef struct {
 
 	// True if this local variable is captured as an upvalue by a function.
 	bool isUpvalue;
+
+	// True if the value of this local variable is read for anything other than calling or subscripting it.
+	bool escapes;
+
+	// Offset of the instruction which allocated the initial value of this local variable, or -1.
+	int32_t allocation;
 } bluLocal;
 
 DECLARE_BUFFER(bluLocal, bluLocal);
@@ -59,6 +65,16 @@ typedef struct bluCompiler {
 
 	int8_t scopeDepth;
 
+	// Offset of the first instruction of the left operand of the infix expression being compiled.
+	int32_t operandStart;
+
+	// Offset and end of the last emitted instruction which allocates an object that could live in a region.
+	int32_t allocation;
+	int32_t allocationEnd;
+
+	// End of the last emitted OP_CALL, used to turn `return f(...)` into a tail call.
+	int32_t callEnd;
+
 	bool hadError;
 	bool panicMode;
 } bluCompiler;
@@ -1,12 +1,21 @@
 #ifndef blu_opcode_h
 #define blu_opcode_h
 
+// Operands of the *_RK instructions address either a slot of the current frame or, when the RK_CONSTANT bit is set, a
+// constant of the current chunk.
+#define RK_CONSTANT 0x8000
+#define RK_MAX (RK_CONSTANT - 1)
+
+// The *_REGION instructions allocate their object in the region of the current frame instead of the heap. The compiler
+// only emits them for objects it proved never outlive the frame. OP_CALL_REGION and OP_INVOKE_REGION mark calls with
+// region allocated arguments, which get moved to the heap unless the callee is known not to retain them.
 typedef enum {
 	OP_CONSTANT,
 	OP_FALSE,
 	OP_NIL,
 	OP_TRUE,
 	OP_ARRAY,
+	OP_ARRAY_REGION,
 
 	OP_POP,
 
@@ -18,13 +27,17 @@ typedef enum {
 	OP_GET_UPVALUE,
 	OP_SET_UPVALUE,
 	OP_GET_PROPERTY,
+	OP_GET_PROPERTY_REGION,
 	OP_SET_PROPERTY,
 	OP_GET_SUPER,
 	OP_SUBSCRIPT_GET,
 	OP_SUBSCRIPT_SET,
 
 	OP_CALL,
+	OP_CALL_REGION,
+	OP_TAIL_CALL,
 	OP_INVOKE,
+	OP_INVOKE_REGION,
 	OP_SUPER,
 	OP_JUMP,
 	OP_JUMP_IF_FALSE,
@@ -46,8 +59,34 @@ typedef enum {
 	OP_NOT,
 	OP_NEGATE,
 
+	// Quickened forms of the arithmetic and comparison instructions. The VM rewrites the generic instruction to one of
+	// these once its operands have only ever been numbers (or strings), and back when the guard fails.
+	OP_GREATER_NUM,
+	OP_GREATER_EQUAL_NUM,
+	OP_LESS_NUM,
+	OP_LESS_EQUAL_NUM,
+	OP_ADD_NUM,
+	OP_ADD_STR,
+	OP_DIVIDE_NUM,
+	OP_SUBTRACT_NUM,
+	OP_MULTIPLY_NUM,
+
+	OP_EQUAL_RK,
+	OP_NOT_EQUAL_RK,
+	OP_GREATER_RK,
+	OP_GREATER_EQUAL_RK,
+	OP_LESS_RK,
+	OP_LESS_EQUAL_RK,
+	OP_ADD_RK,
+	OP_DIVIDE_RK,
+	OP_REMINDER_RK,
+	OP_SUBTRACT_RK,
+	OP_MULTIPLY_RK,
+	OP_POWER_RK,
+
 	OP_CLOSE_OPVALUE,
 	OP_CLOSURE,
+	OP_CLOSURE_REGION,
 
 	OP_CLASS,
 	OP_INHERIT,
@@ -63,4 +102,6 @@ typedef enum {
 	OP_ASSERT,
 } bluOpCode;
 
+#define OP_COUNT (OP_ASSERT + 1)
+
 #endif
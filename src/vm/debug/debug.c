@@ -47,6 +47,27 @@ static int32_t loopInstruction(const char* name, bluChunk* chunk, int32_t offset
 	return offset + 3;
 }
 
+static void registerOperand(bluChunk* chunk, int32_t offset) {
+	uint16_t operand = (uint16_t)((chunk->code.data[offset] << 8) | chunk->code.data[offset + 1]);
+
+	if (operand & RK_CONSTANT) {
+		printf("'");
+		bluPrintValue(chunk->constants.data[operand & RK_MAX]);
+		printf("'");
+	} else {
+		printf("[%d]", operand);
+	}
+}
+
+static int32_t registerInstruction(const char* name, bluChunk* chunk, int32_t offset) {
+	printf("%-16s ", name);
+	registerOperand(chunk, offset + 1);
+	printf(" ");
+	registerOperand(chunk, offset + 3);
+	printf("\n");
+	return offset + 5;
+}
+
 int32_t bluDisassembleInstruction(bluChunk* chunk, int32_t offset) {
 	printf("%04d ", offset);
 	if (offset > 0 && chunk->lines.data[offset] == chunk->lines.data[offset - 1]) {
@@ -64,6 +85,7 @@ int32_t bluDisassembleInstruction(bluChunk* chunk, int32_t offset) {
 	case OP_NIL: return simpleInstruction("OP_NIL", offset);
 	case OP_TRUE: return simpleInstruction("OP_TRUE", offset);
 	case OP_ARRAY: return shortInstruction("OP_ARRAY", chunk, offset);
+	case OP_ARRAY_REGION: return shortInstruction("OP_ARRAY_REGION", chunk, offset);
 
 	case OP_POP: return simpleInstruction("OP_POP", offset);
 
@@ -75,13 +97,17 @@ int32_t bluDisassembleInstruction(bluChunk* chunk, int32_t offset) {
 	case OP_GET_UPVALUE: return shortInstruction("OP_GET_UPVALUE", chunk, offset);
 	case OP_SET_UPVALUE: return shortInstruction("OP_SET_UPVALUE", chunk, offset);
 	case OP_GET_PROPERTY: return shortInstruction("OP_GET_PROPERTY", chunk, offset);
+	case OP_GET_PROPERTY_REGION: return shortInstruction("OP_GET_PROPERTY_REGION", chunk, offset);
 	case OP_SET_PROPERTY: return shortInstruction("OP_SET_PROPERTY", chunk, offset);
 	case OP_GET_SUPER: return shortInstruction("OP_GET_SUPER", chunk, offset);
 	case OP_SUBSCRIPT_GET: return simpleInstruction("OP_SUBSCRIPT_GET", offset);
 	case OP_SUBSCRIPT_SET: return simpleInstruction("OP_SUBSCRIPT_SET", offset);
 
 	case OP_CALL: return byteInstruction("OP_CALL", chunk, offset);
+	case OP_CALL_REGION: return byteInstruction("OP_CALL_REGION", chunk, offset);
+	case OP_TAIL_CALL: return byteInstruction("OP_TAIL_CALL", chunk, offset);
 	case OP_INVOKE: return invokeInstruction("OP_INVOKE", chunk, offset);
+	case OP_INVOKE_REGION: return invokeInstruction("OP_INVOKE_REGION", chunk, offset);
 	case OP_SUPER: return invokeInstruction("OP_SUPER", chunk, offset);
 	case OP_JUMP: return jumpInstruction("OP_JUMP", chunk, offset);
 	case OP_JUMP_IF_FALSE: return jumpInstruction("OP_JUMP_IF_FALSE", chunk, offset);
@@ -103,12 +129,37 @@ int32_t bluDisassembleInstruction(bluChunk* chunk, int32_t offset) {
 	case OP_NOT: return simpleInstruction("OP_NOT", offset);
 	case OP_NEGATE: return simpleInstruction("OP_NEGATE", offset);
 
+	case OP_GREATER_NUM: return simpleInstruction("OP_GREATER_NUM", offset);
+	case OP_GREATER_EQUAL_NUM: return simpleInstruction("OP_GREATER_EQUAL_NUM", offset);
+	case OP_LESS_NUM: return simpleInstruction("OP_LESS_NUM", offset);
+	case OP_LESS_EQUAL_NUM: return simpleInstruction("OP_LESS_EQUAL_NUM", offset);
+	case OP_ADD_NUM: return simpleInstruction("OP_ADD_NUM", offset);
+	case OP_ADD_STR: return simpleInstruction("OP_ADD_STR", offset);
+	case OP_DIVIDE_NUM: return simpleInstruction("OP_DIVIDE_NUM", offset);
+	case OP_SUBTRACT_NUM: return simpleInstruction("OP_SUBTRACT_NUM", offset);
+	case OP_MULTIPLY_NUM: return simpleInstruction("OP_MULTIPLY_NUM", offset);
+
+	case OP_EQUAL_RK: return registerInstruction("OP_EQUAL_RK", chunk, offset);
+	case OP_NOT_EQUAL_RK: return registerInstruction("OP_NOT_EQUAL_RK", chunk, offset);
+	case OP_GREATER_RK: return registerInstruction("OP_GREATER_RK", chunk, offset);
+	case OP_GREATER_EQUAL_RK: return registerInstruction("OP_GREATER_EQUAL_RK", chunk, offset);
+	case OP_LESS_RK: return registerInstruction("OP_LESS_RK", chunk, offset);
+	case OP_LESS_EQUAL_RK: return registerInstruction("OP_LESS_EQUAL_RK", chunk, offset);
+	case OP_ADD_RK: return registerInstruction("OP_ADD_RK", chunk, offset);
+	case OP_DIVIDE_RK: return registerInstruction("OP_DIVIDE_RK", chunk, offset);
+	case OP_REMINDER_RK: return registerInstruction("OP_REMINDER_RK", chunk, offset);
+	case OP_SUBTRACT_RK: return registerInstruction("OP_SUBTRACT_RK", chunk, offset);
+	case OP_MULTIPLY_RK: return registerInstruction("OP_MULTIPLY_RK", chunk, offset);
+	case OP_POWER_RK: return registerInstruction("OP_POWER_RK", chunk, offset);
+
 	case OP_CLOSE_OPVALUE: return simpleInstruction("OP_CLOSE_OPVALUE", offset);
-	case OP_CLOSURE: {
+	case OP_CLOSURE:
+	case OP_CLOSURE_REGION: {
+		const char* name = instruction == OP_CLOSURE ? "OP_CLOSURE" : "OP_CLOSURE_REGION";
 		uint16_t slot = ((chunk->code.data[offset + 1] << 8) & 0xff) | (chunk->code.data[offset + 2] & 0xff);
 		offset += 3;
 
-		printf("%-16s %6d ", "OP_CLOSURE", slot);
+		printf("%-16s %6d ", name, slot);
 		bluPrintValue(chunk->constants.data[slot]);
 		printf("\n");
 
@@ -140,6 +191,90 @@ int32_t bluDisassembleInstruction(bluChunk* chunk, int32_t offset) {
 	}
 }
 
+static const char* opCodeNames[] = {
+	[OP_CONSTANT] = "OP_CONSTANT",
+	[OP_FALSE] = "OP_FALSE",
+	[OP_NIL] = "OP_NIL",
+	[OP_TRUE] = "OP_TRUE",
+	[OP_ARRAY] = "OP_ARRAY",
+	[OP_ARRAY_REGION] = "OP_ARRAY_REGION",
+	[OP_POP] = "OP_POP",
+	[OP_GET_LOCAL] = "OP_GET_LOCAL",
+	[OP_SET_LOCAL] = "OP_SET_LOCAL",
+	[OP_DEFINE_GLOBAL] = "OP_DEFINE_GLOBAL",
+	[OP_GET_GLOBAL] = "OP_GET_GLOBAL",
+	[OP_SET_GLOBAL] = "OP_SET_GLOBAL",
+	[OP_GET_UPVALUE] = "OP_GET_UPVALUE",
+	[OP_SET_UPVALUE] = "OP_SET_UPVALUE",
+	[OP_GET_PROPERTY] = "OP_GET_PROPERTY",
+	[OP_GET_PROPERTY_REGION] = "OP_GET_PROPERTY_REGION",
+	[OP_SET_PROPERTY] = "OP_SET_PROPERTY",
+	[OP_GET_SUPER] = "OP_GET_SUPER",
+	[OP_SUBSCRIPT_GET] = "OP_SUBSCRIPT_GET",
+	[OP_SUBSCRIPT_SET] = "OP_SUBSCRIPT_SET",
+	[OP_CALL] = "OP_CALL",
+	[OP_CALL_REGION] = "OP_CALL_REGION",
+	[OP_TAIL_CALL] = "OP_TAIL_CALL",
+	[OP_INVOKE] = "OP_INVOKE",
+	[OP_INVOKE_REGION] = "OP_INVOKE_REGION",
+	[OP_SUPER] = "OP_SUPER",
+	[OP_JUMP] = "OP_JUMP",
+	[OP_JUMP_IF_FALSE] = "OP_JUMP_IF_FALSE",
+	[OP_JUMP_IF_TRUE] = "OP_JUMP_IF_TRUE",
+	[OP_LOOP] = "OP_LOOP",
+	[OP_EQUAL] = "OP_EQUAL",
+	[OP_NOT_EQUAL] = "OP_NOT_EQUAL",
+	[OP_GREATER] = "OP_GREATER",
+	[OP_GREATER_EQUAL] = "OP_GREATER_EQUAL",
+	[OP_LESS] = "OP_LESS",
+	[OP_LESS_EQUAL] = "OP_LESS_EQUAL",
+	[OP_ADD] = "OP_ADD",
+	[OP_DIVIDE] = "OP_DIVIDE",
+	[OP_REMINDER] = "OP_REMINDER",
+	[OP_SUBTRACT] = "OP_SUBTRACT",
+	[OP_MULTIPLY] = "OP_MULTIPLY",
+	[OP_POWER] = "OP_POWER",
+	[OP_NOT] = "OP_NOT",
+	[OP_NEGATE] = "OP_NEGATE",
+	[OP_GREATER_NUM] = "OP_GREATER_NUM",
+	[OP_GREATER_EQUAL_NUM] = "OP_GREATER_EQUAL_NUM",
+	[OP_LESS_NUM] = "OP_LESS_NUM",
+	[OP_LESS_EQUAL_NUM] = "OP_LESS_EQUAL_NUM",
+	[OP_ADD_NUM] = "OP_ADD_NUM",
+	[OP_ADD_STR] = "OP_ADD_STR",
+	[OP_DIVIDE_NUM] = "OP_DIVIDE_NUM",
+	[OP_SUBTRACT_NUM] = "OP_SUBTRACT_NUM",
+	[OP_MULTIPLY_NUM] = "OP_MULTIPLY_NUM",
+	[OP_EQUAL_RK] = "OP_EQUAL_RK",
+	[OP_NOT_EQUAL_RK] = "OP_NOT_EQUAL_RK",
+	[OP_GREATER_RK] = "OP_GREATER_RK",
+	[OP_GREATER_EQUAL_RK] = "OP_GREATER_EQUAL_RK",
+	[OP_LESS_RK] = "OP_LESS_RK",
+	[OP_LESS_EQUAL_RK] = "OP_LESS_EQUAL_RK",
+	[OP_ADD_RK] = "OP_ADD_RK",
+	[OP_DIVIDE_RK] = "OP_DIVIDE_RK",
+	[OP_REMINDER_RK] = "OP_REMINDER_RK",
+	[OP_SUBTRACT_RK] = "OP_SUBTRACT_RK",
+	[OP_MULTIPLY_RK] = "OP_MULTIPLY_RK",
+	[OP_POWER_RK] = "OP_POWER_RK",
+	[OP_CLOSE_OPVALUE] = "OP_CLOSE_OPVALUE",
+	[OP_CLOSURE] = "OP_CLOSURE",
+	[OP_CLOSURE_REGION] = "OP_CLOSURE_REGION",
+	[OP_CLASS] = "OP_CLASS",
+	[OP_INHERIT] = "OP_INHERIT",
+	[OP_METHOD] = "OP_METHOD",
+	[OP_METHOD_FOREIGN] = "OP_METHOD_FOREIGN",
+	[OP_METHOD_STATIC] = "OP_METHOD_STATIC",
+	[OP_IMPORT] = "OP_IMPORT",
+	[OP_ECHO] = "OP_ECHO",
+	[OP_RETURN] = "OP_RETURN",
+	[OP_ASSERT] = "OP_ASSERT",
+};
+
+const char* bluOpCodeName(uint8_t instruction) {
+	return instruction < OP_COUNT ? opCodeNames[instruction] : "OP_UNKNOWN";
+}
+
 void bluDisassembleChunk(bluChunk* chunk) {
 	printf("========= %s::%s\n", chunk->file, chunk->name);
 
@@ -6,4 +6,7 @@
 int32_t bluDisassembleInstruction(bluChunk* chunk, int32_t offset);
 void bluDisassembleChunk(bluChunk* chunk);
 
+// Returns the name of [instruction], as the disassembler prints it.
+const char* bluOpCodeName(uint8_t instruction);
+
 #endif
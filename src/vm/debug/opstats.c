@@ -0,0 +1,115 @@
+#include "opstats.h"
+
+#ifdef BLU_OPSTATS
+
+#include "vm/debug/debug.h"
+#include "vm/object.h"
+
+// Pairs printed when the VM is freed. All of them are kept in the object scripts get.
+#define OPSTATS_PAIRS_PRINTED 40
+
+typedef struct {
+	uint8_t first;
+	uint8_t second;
+	uint64_t count;
+} OpCount;
+
+static int compareCounts(const void* a, const void* b) {
+	uint64_t left = ((const OpCount*)a)->count;
+	uint64_t right = ((const OpCount*)b)->count;
+
+	return (left < right) - (left > right);
+}
+
+// Collects the instructions, or the pairs when [pairs] is set, that ran at least once into [counts], most frequent
+// first. Returns how many there are.
+static int32_t collectCounts(bluVM* vm, bool pairs, OpCount* counts) {
+	int32_t count = 0;
+
+	for (int32_t first = 0; first < OP_COUNT; first++) {
+		if (!pairs) {
+			if (vm->opCounts[first] != 0) counts[count++] = (OpCount){first, 0, vm->opCounts[first]};
+			continue;
+		}
+
+		for (int32_t second = 0; second < OP_COUNT; second++) {
+			if (vm->opPairs[first][second] != 0) counts[count++] = (OpCount){first, second, vm->opPairs[first][second]};
+		}
+	}
+
+	qsort(counts, count, sizeof(OpCount), compareCounts);
+
+	return count;
+}
+
+void bluPrintOpStats(bluVM* vm, FILE* file) {
+	OpCount* counts = malloc(sizeof(OpCount) * OP_COUNT * OP_COUNT);
+
+	uint64_t total = 0;
+	for (int32_t i = 0; i < OP_COUNT; i++) {
+		total += vm->opCounts[i];
+	}
+
+	if (total == 0) total = 1;
+
+	fprintf(file, "Instructions:\n");
+
+	int32_t count = collectCounts(vm, false, counts);
+	for (int32_t i = 0; i < count; i++) {
+		fprintf(file, "  %-24s %14lu %6.2f%%\n", bluOpCodeName(counts[i].first), counts[i].count,
+		        100.0 * counts[i].count / total);
+	}
+
+	fprintf(file, "Pairs:\n");
+
+	count = collectCounts(vm, true, counts);
+	for (int32_t i = 0; i < count && i < OPSTATS_PAIRS_PRINTED; i++) {
+		fprintf(file, "  %-24s %-24s %14lu %6.2f%%\n", bluOpCodeName(counts[i].first), bluOpCodeName(counts[i].second),
+		        counts[i].count, 100.0 * counts[i].count / total);
+	}
+
+	free(counts);
+}
+
+static bluValue opName(bluVM* vm, uint8_t instruction) {
+	const char* name = bluOpCodeName(instruction);
+
+	return OBJ_VAL(bluCopyString(vm, name, strlen(name)));
+}
+
+bluValue bluOpStatsValue(bluVM* vm) {
+	OpCount* counts = malloc(sizeof(OpCount) * OP_COUNT * OP_COUNT);
+
+	int32_t count = collectCounts(vm, false, counts);
+	bluObjArray* ops = bluNewArray(vm, count);
+
+	for (int32_t i = 0; i < count; i++) {
+		bluObjArray* op = bluNewArray(vm, 2);
+		op->data[0] = opName(vm, counts[i].first);
+		op->data[1] = NUMBER_VAL((double)counts[i].count);
+
+		ops->data[i] = OBJ_VAL(op);
+	}
+
+	count = collectCounts(vm, true, counts);
+	bluObjArray* pairs = bluNewArray(vm, count);
+
+	for (int32_t i = 0; i < count; i++) {
+		bluObjArray* pair = bluNewArray(vm, 3);
+		pair->data[0] = opName(vm, counts[i].first);
+		pair->data[1] = opName(vm, counts[i].second);
+		pair->data[2] = NUMBER_VAL((double)counts[i].count);
+
+		pairs->data[i] = OBJ_VAL(pair);
+	}
+
+	free(counts);
+
+	bluObjInstance* stats = bluNewInstance(vm, (bluObjClass*)bluGetGlobal(vm, "Object"));
+	bluTableSet(vm, &stats->fields, bluCopyString(vm, "ops", 3), OBJ_VAL(ops));
+	bluTableSet(vm, &stats->fields, bluCopyString(vm, "pairs", 5), OBJ_VAL(pairs));
+
+	return OBJ_VAL(stats);
+}
+
+#endif
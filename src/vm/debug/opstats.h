@@ -0,0 +1,18 @@
+#ifndef blu_opstats_h
+#define blu_opstats_h
+
+#include "vm/common.h"
+#include "vm/vm.h"
+
+#ifdef BLU_OPSTATS
+
+// Prints how often every instruction and the most frequent pairs of consecutive instructions ran, most frequent first.
+void bluPrintOpStats(bluVM* vm, FILE* file);
+
+// Returns the counters as an object with [ops], an array of [name, count] arrays, and [pairs], an array of
+// [first, second, count] arrays, both sorted like bluPrintOpStats() prints them.
+bluValue bluOpStatsValue(bluVM* vm);
+
+#endif
+
+#endif
@@ -0,0 +1,479 @@
+#include "include/blu.h"
+
+#include <inttypes.h>
+
+#include "util/buffer.h"
+#include "vm/image.h"
+#include "vm/memory.h"
+#include "vm/object.h"
+#include "vm/vm.h"
+
+// Heap snapshots are written in the .heapsnapshot format of Chrome, which its DevTools load in the Memory tab. Every
+// object of the VM is a node, references between objects are edges and the first node is a synthetic root referencing
+// everything the GC starts marking from. Nodes and edges are flat arrays of numbers, strings are indices into the
+// strings array at the end. Objects nothing references any more are written too, DevTools leaves them out.
+
+// Longest name a string node gets, longer strings are cut.
+#define SNAPSHOT_NAME_MAX 1024
+
+// Fields of every node and every edge in the flat arrays.
+#define NODE_FIELDS "\"type\",\"name\",\"id\",\"self_size\",\"edge_count\",\"trace_node_id\""
+#define EDGE_FIELDS "\"type\",\"name_or_index\",\"to_node\""
+#define NODE_FIELD_COUNT 6
+
+typedef enum {
+	NODE_HIDDEN,
+	NODE_ARRAY,
+	NODE_STRING,
+	NODE_OBJECT,
+	NODE_CODE,
+	NODE_CLOSURE,
+	NODE_REGEXP,
+	NODE_NUMBER,
+	NODE_NATIVE,
+	NODE_SYNTHETIC,
+} NodeType;
+
+#define NODE_TYPES                                                                                                     \
+	"\"hidden\",\"array\",\"string\",\"object\",\"code\",\"closure\",\"regexp\",\"number\",\"native\",\"synthetic\""
+
+typedef enum {
+	EDGE_CONTEXT,
+	EDGE_ELEMENT,
+	EDGE_PROPERTY,
+	EDGE_INTERNAL,
+} EdgeType;
+
+#define EDGE_TYPES "\"context\",\"element\",\"property\",\"internal\",\"hidden\",\"shortcut\",\"weak\""
+
+typedef struct {
+	const char* chars;
+	int32_t length;
+	uint32_t hash;
+	int32_t index;
+} SnapshotString;
+
+typedef struct {
+	bluObj* object;
+	int32_t index;
+} SnapshotNode;
+
+typedef struct {
+	bluVM* vm;
+
+	// Index of every object's node, by address.
+	SnapshotNode* nodes;
+	int32_t nodeMask;
+	int32_t nodeCount;
+
+	// Distinct strings, in the order of their indices.
+	SnapshotString* strings;
+	int32_t stringMask;
+	int32_t stringCount;
+	SnapshotString** stringOrder;
+
+	ByteBuffer nodeData;
+	ByteBuffer edgeData;
+	int32_t edgeCount;
+
+	// Edges of the node being written.
+	int32_t nodeEdges;
+} Snapshot;
+
+static uint32_t hashPointer(bluObj* object) {
+	uint64_t bits = (uint64_t)(uintptr_t)object;
+
+	return (uint32_t)((bits >> 4) * 0x9E3779B97F4A7C15u >> 32);
+}
+
+static uint32_t hashChars(const char* chars, int32_t length) {
+	uint32_t hash = 2166136261u;
+
+	for (int32_t i = 0; i < length; i++) {
+		hash ^= (uint8_t)chars[i];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+static int32_t tableMask(int32_t count) {
+	int32_t capacity = 16;
+	while (capacity < count * 2) capacity *= 2;
+
+	return capacity - 1;
+}
+
+static void addNode(Snapshot* snapshot, bluObj* object) {
+	for (uint32_t i = hashPointer(object) & snapshot->nodeMask;; i = (i + 1) & snapshot->nodeMask) {
+		if (snapshot->nodes[i].object == NULL) {
+			snapshot->nodes[i].object = object;
+			snapshot->nodes[i].index = ++snapshot->nodeCount;
+			return;
+		}
+	}
+}
+
+// Returns the index of [object]'s node, or -1 for objects of an image, which aren't part of the snapshot.
+static int32_t findNode(Snapshot* snapshot, bluObj* object) {
+	for (uint32_t i = hashPointer(object) & snapshot->nodeMask;; i = (i + 1) & snapshot->nodeMask) {
+		if (snapshot->nodes[i].object == object) return snapshot->nodes[i].index;
+		if (snapshot->nodes[i].object == NULL) return -1;
+	}
+}
+
+static int32_t findString(Snapshot* snapshot, const char* chars, int32_t length) {
+	uint32_t hash = hashChars(chars, length);
+
+	for (uint32_t i = hash & snapshot->stringMask;; i = (i + 1) & snapshot->stringMask) {
+		SnapshotString* string = &snapshot->strings[i];
+
+		if (string->chars == NULL) {
+			string->chars = chars;
+			string->length = length;
+			string->hash = hash;
+			string->index = snapshot->stringCount;
+
+			snapshot->stringOrder[snapshot->stringCount++] = string;
+
+			if (snapshot->stringCount * 2 > snapshot->stringMask + 1) {
+				int32_t mask = snapshot->stringMask * 2 + 1;
+				SnapshotString* strings = calloc(mask + 1, sizeof(SnapshotString));
+
+				for (int32_t j = 0; j < snapshot->stringCount; j++) {
+					SnapshotString* old = snapshot->stringOrder[j];
+
+					uint32_t k = old->hash & mask;
+					while (strings[k].chars != NULL) k = (k + 1) & mask;
+
+					strings[k] = *old;
+					snapshot->stringOrder[j] = &strings[k];
+				}
+
+				free(snapshot->strings);
+				snapshot->strings = strings;
+				snapshot->stringMask = mask;
+
+				snapshot->stringOrder = realloc(snapshot->stringOrder, sizeof(SnapshotString*) * (mask + 1));
+			}
+
+			return snapshot->stringCount - 1;
+		}
+
+		if (string->hash == hash && string->length == length && memcmp(string->chars, chars, length) == 0) {
+			return string->index;
+		}
+	}
+}
+
+static int32_t findCString(Snapshot* snapshot, const char* chars) {
+	return findString(snapshot, chars, strlen(chars));
+}
+
+static void writeNumbers(ByteBuffer* buffer, int32_t count, const int64_t* numbers) {
+	char chars[24];
+
+	for (int32_t i = 0; i < count; i++) {
+		const char* format = buffer->count == 0 && i == 0 ? "%" PRId64 : ",%" PRId64;
+		int32_t length = snprintf(chars, sizeof(chars), format, numbers[i]);
+		ByteBufferAppend(buffer, chars, length);
+	}
+}
+
+static void writeEdge(Snapshot* snapshot, EdgeType type, int32_t nameOrIndex, bluObj* object) {
+	if (object == NULL) return;
+
+	int32_t node = findNode(snapshot, object);
+	if (node < 0) return;
+
+	int64_t edge[] = {type, nameOrIndex, node * NODE_FIELD_COUNT};
+	writeNumbers(&snapshot->edgeData, 3, edge);
+
+	snapshot->edgeCount++;
+	snapshot->nodeEdges++;
+}
+
+static void writeValueEdge(Snapshot* snapshot, EdgeType type, int32_t nameOrIndex, bluValue value) {
+	if (IS_OBJ(value)) writeEdge(snapshot, type, nameOrIndex, AS_OBJ(value));
+}
+
+static void writeInternalEdge(Snapshot* snapshot, const char* name, bluObj* object) {
+	if (object != NULL) writeEdge(snapshot, EDGE_INTERNAL, findCString(snapshot, name), object);
+}
+
+static void writeTableEdges(Snapshot* snapshot, bluTable* table) {
+	for (int32_t i = 0; i <= table->capacityMask; i++) {
+		bluEntry* entry = &table->entries[i];
+		if (entry->key == NULL) continue;
+
+		writeValueEdge(snapshot, EDGE_PROPERTY, findString(snapshot, entry->key->chars, entry->key->length),
+		               entry->value);
+	}
+}
+
+static void writeNode(Snapshot* snapshot, NodeType type, int32_t name, int32_t index, size_t size) {
+	int64_t node[] = {type, name, index * 2 + 1, (int64_t)size, snapshot->nodeEdges, 0};
+	writeNumbers(&snapshot->nodeData, NODE_FIELD_COUNT, node);
+
+	snapshot->nodeEdges = 0;
+}
+
+// Name of a function or a class, which may have none.
+static const char* nameOf(bluObjString* name, const char* fallback) {
+	return name != NULL ? name->chars : fallback;
+}
+
+static void writeObject(Snapshot* snapshot, bluObj* object, int32_t index) {
+	NodeType type = NODE_HIDDEN;
+	int32_t name = 0;
+
+	if (object->type != OBJ_CLASS) writeInternalEdge(snapshot, "class", (bluObj*)object->class);
+
+	switch (object->type) {
+	case OBJ_ARRAY: {
+		bluObjArray* array = (bluObjArray*)object;
+
+		for (int32_t i = 0; i < array->len; i++) {
+			writeValueEdge(snapshot, EDGE_ELEMENT, i, array->data[i]);
+		}
+
+		type = NODE_ARRAY;
+		name = findCString(snapshot, "Array");
+		break;
+	}
+
+	case OBJ_BOUND_METHOD: {
+		bluObjBoundMethod* bound = (bluObjBoundMethod*)object;
+
+		if (IS_OBJ(bound->receiver)) writeInternalEdge(snapshot, "receiver", AS_OBJ(bound->receiver));
+		writeInternalEdge(snapshot, "closure", (bluObj*)bound->closure);
+
+		type = NODE_CLOSURE;
+		name = findCString(snapshot, nameOf(bound->closure->function->name, "__anonymous"));
+		break;
+	}
+
+	case OBJ_CLASS: {
+		bluObjClass* class = (bluObjClass*)object;
+
+		writeInternalEdge(snapshot, "name", (bluObj*)class->name);
+		writeInternalEdge(snapshot, "superclass", (bluObj*)class->superclass);
+		writeTableEdges(snapshot, &class->methods);
+		writeTableEdges(snapshot, &class->fields);
+
+		type = NODE_OBJECT;
+		name = findCString(snapshot, nameOf(class->name, "Class"));
+		break;
+	}
+
+	case OBJ_CLOSURE: {
+		bluObjClosure* closure = (bluObjClosure*)object;
+
+		writeInternalEdge(snapshot, "function", (bluObj*)closure->function);
+		for (int32_t i = 0; i < closure->upvalues.count; i++) {
+			writeEdge(snapshot, EDGE_CONTEXT, findCString(snapshot, "upvalue"), (bluObj*)closure->upvalues.data[i]);
+		}
+
+		type = NODE_CLOSURE;
+		name = findCString(snapshot, nameOf(closure->function->name, "__anonymous"));
+		break;
+	}
+
+	case OBJ_FIBER: {
+		bluObjFiber* fiber = (bluObjFiber*)object;
+
+		if (IS_OBJ(fiber->callee)) writeInternalEdge(snapshot, "callee", AS_OBJ(fiber->callee));
+		writeInternalEdge(snapshot, "caller", (bluObj*)fiber->caller);
+
+		for (bluValue* slot = fiber->stack; slot < fiber->stackTop; slot++) {
+			writeValueEdge(snapshot, EDGE_ELEMENT, slot - fiber->stack, *slot);
+		}
+
+		for (int32_t i = 0; i < fiber->frameCount; i++) {
+			writeInternalEdge(snapshot, "frame", (bluObj*)fiber->frames[i].closure);
+		}
+
+		type = NODE_OBJECT;
+		name = findCString(snapshot, "Fiber");
+		break;
+	}
+
+	case OBJ_FUNCTION: {
+		bluObjFunction* function = (bluObjFunction*)object;
+
+		writeInternalEdge(snapshot, "name", (bluObj*)function->name);
+		for (int32_t i = 0; i < function->chunk.constants.count; i++) {
+			bluValue constant = function->chunk.constants.data[i];
+			if (IS_OBJ(constant)) writeInternalEdge(snapshot, "constant", AS_OBJ(constant));
+		}
+
+		type = NODE_CODE;
+		name = findCString(snapshot, function->chunk.name);
+		break;
+	}
+
+	case OBJ_INSTANCE: {
+		bluObjInstance* instance = (bluObjInstance*)object;
+
+		writeTableEdges(snapshot, &instance->fields);
+
+		type = NODE_OBJECT;
+		name = findCString(snapshot, nameOf(instance->obj.class->name, "Object"));
+		break;
+	}
+
+	case OBJ_NATIVE: {
+		bluObjNative* native = (bluObjNative*)object;
+
+		writeInternalEdge(snapshot, "name", (bluObj*)native->name);
+
+		type = NODE_NATIVE;
+		name = native->name != NULL ? findString(snapshot, native->name->chars, native->name->length)
+		                            : findCString(snapshot, "native");
+		break;
+	}
+
+	case OBJ_STRING: {
+		bluObjString* string = (bluObjString*)object;
+
+		type = NODE_STRING;
+		name = findString(snapshot, string->chars, string->length < SNAPSHOT_NAME_MAX ? string->length : SNAPSHOT_NAME_MAX);
+		break;
+	}
+
+	case OBJ_UPVALUE: {
+		bluObjUpvalue* upvalue = (bluObjUpvalue*)object;
+
+		if (IS_OBJ(*upvalue->value)) writeInternalEdge(snapshot, "value", AS_OBJ(*upvalue->value));
+
+		type = NODE_HIDDEN;
+		name = findCString(snapshot, "upvalue");
+		break;
+	}
+	}
+
+	writeNode(snapshot, type, name, index, bluObjectSize(object));
+}
+
+// The root references the same objects bluCollectGarbage() starts from. Globals are named after their variables.
+static void writeRoot(Snapshot* snapshot) {
+	bluVM* vm = snapshot->vm;
+
+	for (bluValue* slot = vm->stack; slot < vm->stackTop; slot++) {
+		writeValueEdge(snapshot, EDGE_ELEMENT, slot - vm->stack, *slot);
+	}
+
+	for (int32_t i = 0; i < vm->frameCount; i++) {
+		writeInternalEdge(snapshot, "frame", (bluObj*)vm->frames[i].closure);
+	}
+
+	for (bluObjUpvalue* upvalue = vm->openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+		writeInternalEdge(snapshot, "upvalue", (bluObj*)upvalue);
+	}
+
+	writeInternalEdge(snapshot, "fiber", (bluObj*)vm->fiber);
+	writeInternalEdge(snapshot, "resumed", (bluObj*)vm->resumed);
+	if (IS_OBJ(vm->transfer)) writeInternalEdge(snapshot, "transfer", AS_OBJ(vm->transfer));
+
+	for (int32_t i = 0; i < vm->modules.count; i++) {
+		writeInternalEdge(snapshot, "module", (bluObj*)vm->modules.data[i].name);
+	}
+
+	writeTableEdges(snapshot, &vm->globals);
+
+	writeInternalEdge(snapshot, "initializer", (bluObj*)vm->stringInitializer);
+
+	if (vm->image != NULL) {
+		for (int32_t i = 0; i < vm->image->classCount; i++) {
+			writeInternalEdge(snapshot, "class", (bluObj*)vm->sharedClasses[i]);
+		}
+	}
+
+	for (bluObj* object = vm->regionObjects; object != NULL; object = object->next) {
+		writeInternalEdge(snapshot, "region", object);
+	}
+
+	writeNode(snapshot, NODE_SYNTHETIC, findCString(snapshot, "(GC roots)"), 0, 0);
+}
+
+static void writeString(FILE* file, const char* chars, int32_t length) {
+	fputc('"', file);
+
+	for (int32_t i = 0; i < length; i++) {
+		uint8_t c = chars[i];
+
+		if (c == '"' || c == '\\') {
+			fputc('\\', file);
+			fputc(c, file);
+		} else if (c < 0x20) {
+			fprintf(file, "\\u%04x", c);
+		} else {
+			fputc(c, file);
+		}
+	}
+
+	fputc('"', file);
+}
+
+bool bluWriteHeapSnapshot(bluVM* vm, const char* path) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) return false;
+
+	int32_t objectCount = 0;
+	for (bluObj* object = vm->objects; object != NULL; object = object->next) objectCount++;
+	for (bluObj* object = vm->regionObjects; object != NULL; object = object->next) objectCount++;
+
+	Snapshot snapshot;
+	snapshot.vm = vm;
+	snapshot.nodeMask = tableMask(objectCount);
+	snapshot.nodes = calloc(snapshot.nodeMask + 1, sizeof(SnapshotNode));
+	snapshot.nodeCount = 0;
+	snapshot.stringMask = tableMask(256);
+	snapshot.strings = calloc(snapshot.stringMask + 1, sizeof(SnapshotString));
+	snapshot.stringOrder = malloc(sizeof(SnapshotString*) * (snapshot.stringMask + 1));
+	snapshot.stringCount = 0;
+	snapshot.edgeCount = 0;
+	snapshot.nodeEdges = 0;
+	ByteBufferInit(&snapshot.nodeData);
+	ByteBufferInit(&snapshot.edgeData);
+
+	for (bluObj* object = vm->objects; object != NULL; object = object->next) addNode(&snapshot, object);
+	for (bluObj* object = vm->regionObjects; object != NULL; object = object->next) addNode(&snapshot, object);
+
+	writeRoot(&snapshot);
+
+	// Nodes are numbered in the order they were added.
+	int32_t index = 0;
+	for (bluObj* object = vm->objects; object != NULL; object = object->next) writeObject(&snapshot, object, ++index);
+	for (bluObj* object = vm->regionObjects; object != NULL; object = object->next) {
+		writeObject(&snapshot, object, ++index);
+	}
+
+	fprintf(file, "{\"snapshot\":{\"meta\":{");
+	fprintf(file, "\"node_fields\":[" NODE_FIELDS "],");
+	fprintf(file, "\"node_types\":[[" NODE_TYPES "],\"string\",\"number\",\"number\",\"number\",\"number\"],");
+	fprintf(file, "\"edge_fields\":[" EDGE_FIELDS "],");
+	fprintf(file, "\"edge_types\":[[" EDGE_TYPES "],\"string_or_number\",\"node\"]},");
+	fprintf(file, "\"node_count\":%d,\"edge_count\":%d},\n", snapshot.nodeCount + 1, snapshot.edgeCount);
+
+	fprintf(file, "\"nodes\":[");
+	fwrite(snapshot.nodeData.data, 1, snapshot.nodeData.count, file);
+	fprintf(file, "],\n\"edges\":[");
+	fwrite(snapshot.edgeData.data, 1, snapshot.edgeData.count, file);
+	fprintf(file, "],\n\"strings\":[");
+
+	for (int32_t i = 0; i < snapshot.stringCount; i++) {
+		if (i != 0) fputc(',', file);
+		writeString(file, snapshot.stringOrder[i]->chars, snapshot.stringOrder[i]->length);
+	}
+
+	fprintf(file, "]}\n");
+
+	free(snapshot.nodes);
+	free(snapshot.strings);
+	free(snapshot.stringOrder);
+	ByteBufferFree(&snapshot.nodeData);
+	ByteBufferFree(&snapshot.edgeData);
+
+	return fclose(file) == 0;
+}
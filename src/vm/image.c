@@ -0,0 +1,123 @@
+#include "image.h"
+#include "vm/memory.h"
+#include "vm/table.h"
+
+bluImage* bluNewImage() {
+	bluImage* image = malloc(sizeof(bluImage));
+	image->vm = bluNewVM();
+	image->classCount = 0;
+
+	for (bluObj* object = image->vm->objects; object != NULL; object = object->next) {
+		if (object->type == OBJ_CLASS) image->classCount++;
+	}
+
+	image->classes = malloc(sizeof(bluObjClass*) * image->classCount);
+
+	int32_t classCount = 0;
+	for (bluObj* object = image->vm->objects; object != NULL; object = object->next) {
+		object->isShared = true;
+
+		if (object->type == OBJ_CLASS) {
+			bluObjClass* class = (bluObjClass*)object;
+			class->sharedIndex = classCount;
+			image->classes[classCount++] = class;
+		}
+	}
+
+	return image;
+}
+
+void bluFreeImage(bluImage* image) {
+	bluFreeVM(image->vm);
+
+	free(image->classes);
+	free(image);
+}
+
+void bluAttachImage(bluVM* vm, bluImage* image) {
+	bluVM* core = image->vm;
+
+	vm->image = image;
+
+	vm->sharedClasses = malloc(sizeof(bluObjClass*) * image->classCount);
+	memcpy(vm->sharedClasses, image->classes, sizeof(bluObjClass*) * image->classCount);
+
+	vm->nilClass = core->nilClass;
+	vm->boolClass = core->boolClass;
+	vm->numberClass = core->numberClass;
+	vm->arrayClass = core->arrayClass;
+	vm->classClass = core->classClass;
+	vm->functionClass = core->functionClass;
+	vm->stringClass = core->stringClass;
+	vm->fiberClass = core->fiberClass;
+
+	vm->stringInitializer = core->stringInitializer;
+
+	// Globals are per VM, they just start out pointing to the shared objects.
+	bluTableAddAll(vm, &core->globals, &vm->globals);
+
+	for (int32_t i = 0; i < core->modules.count; i++) {
+		bluModule module = core->modules.data[i];
+		module.loaded = false;
+		module.source = NULL;
+
+		bluModuleBufferWrite(&vm->modules, module);
+	}
+}
+
+bool bluResetVM(bluVM* vm) {
+	bluImage* image = vm->image;
+	if (image == NULL) return false;
+
+	bluFlushOutput(vm);
+	vm->outputLimit = vm->configuredOutputLimit;
+
+	vm->stackTop = vm->stack;
+	vm->frameCount = 0;
+	vm->frameCountStart = 0;
+	vm->openUpvalues = NULL;
+
+	bluReleaseRegion(vm, vm->region);
+
+	bluTableFree(vm, &vm->globals);
+	bluTableInit(vm, &vm->globals);
+	bluTableAddAll(vm, &image->vm->globals, &vm->globals);
+
+	memcpy(vm->sharedClasses, image->classes, sizeof(bluObjClass*) * image->classCount);
+
+	// Modules get imported anew, with new classes.
+	vm->mappingClass = NULL;
+	vm->linesClass = NULL;
+	vm->viewClass = NULL;
+
+	for (int32_t i = 0; i < vm->modules.count; i++) {
+		bluModule* module = &vm->modules.data[i];
+		if (module->source != NULL) free(module->source);
+
+		module->loaded = false;
+		module->source = NULL;
+	}
+
+	// Nothing but shared objects is reachable now, so this frees everything the scripts allocated.
+	bluCollectGarbage(vm);
+
+	return true;
+}
+
+bluObjClass* bluWritableClass(bluVM* vm, bluObjClass* class) {
+	class = bluResolveClass(vm, class);
+
+	if (!class->obj.isShared) return class;
+
+	bluObjClass* copy = bluNewClass(vm, class->name);
+	copy->superclass = class->superclass;
+	copy->construct = class->construct;
+	copy->destruct = class->destruct;
+
+	bluTableAddAll(vm, &class->methods, &copy->methods);
+	bluTableAddAll(vm, &class->fields, &copy->fields);
+
+	vm->sharedClasses[class->sharedIndex] = copy;
+
+	return copy;
+}
@@ -0,0 +1,24 @@
+#ifndef blu_image_h
+#define blu_image_h
+
+#include "include/blu.h"
+#include "vm/object.h"
+#include "vm/vm.h"
+
+struct bluImage {
+	// VM the core library was loaded into. It never runs code again and all of its objects are shared.
+	bluVM* vm;
+
+	// Classes of the image, indexed by their sharedIndex.
+	bluObjClass** classes;
+	int32_t classCount;
+};
+
+// Sets [vm] up to use the core library of [image] instead of loading its own.
+void bluAttachImage(bluVM* vm, bluImage* image);
+
+// Returns the class whose methods and fields this VM may change in place of [class]. Shared classes are copied into the
+// VM on the first change, later lookups find the copy through bluResolveClass().
+bluObjClass* bluWritableClass(bluVM* vm, bluObjClass* class);
+
+#endif
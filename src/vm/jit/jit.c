@@ -0,0 +1,777 @@
+#include "jit.h"
+
+#ifdef BLU_JIT
+
+#include <sys/mman.h>
+
+#include "vm/vm.h"
+
+// The native code is a sequence of templates, one for each bytecode instruction. It works directly on the VM's value
+// stack, so the stack is always in the state the interpreter expects. Whenever an instruction has no template, or its
+// fast path does not apply (e.g. adding strings), the native code stores frame->ip and vm->stackTop and returns, and the
+// interpreter executes the instruction instead. Calls, returns, allocation, method lookup and errors are all handled
+// this way by the interpreter.
+//
+// These registers are pinned for the whole native code:
+//
+//   rbx - bluVM* vm
+//   r12 - bluValue* slots of the frame
+//   r13 - bluValue* top of the value stack
+//   r14 - bluCallFrame* frame
+
+typedef enum {
+	RAX,
+	RCX,
+	RDX,
+	RBX,
+	RSP,
+	RBP,
+	RSI,
+	RDI,
+	R8,
+	R9,
+	R10,
+	R11,
+	R12,
+	R13,
+	R14,
+	R15,
+} Register;
+
+typedef enum {
+	XMM0,
+	XMM1,
+} XmmRegister;
+
+typedef enum {
+	CC_B = 0x2,
+	CC_AE = 0x3,
+	CC_E = 0x4,
+	CC_NE = 0x5,
+	CC_BE = 0x6,
+	CC_A = 0x7,
+} Condition;
+
+#define REG_VM RBX
+#define REG_SLOTS R12
+#define REG_TOP R13
+#define REG_FRAME R14
+
+#define VALUE_SIZE ((int32_t)sizeof(bluValue))
+#define TYPE_OFFSET ((int32_t)offsetof(bluValue, type))
+#define AS_OFFSET ((int32_t)offsetof(bluValue, as))
+
+// Displacement of the type and the payload of the value [distance] slots below the top of the stack.
+#define PEEK_TYPE(distance) (-VALUE_SIZE * ((distance) + 1) + TYPE_OFFSET)
+#define PEEK_AS(distance) (-VALUE_SIZE * ((distance) + 1) + AS_OFFSET)
+
+_Static_assert(sizeof(bluValueType) == 4, "Value type has to be 32 bits wide.");
+_Static_assert(sizeof(bluValue) == 16, "Value has to be 16 bytes wide.");
+
+typedef struct {
+	// Native offset of the rel32 operand to patch.
+	int32_t at;
+
+	// Bytecode offset of the jump target.
+	int32_t target;
+} bluJitFixup;
+
+DECLARE_BUFFER(bluJitFixup, bluJitFixup);
+DEFINE_BUFFER(bluJitFixup, bluJitFixup);
+
+typedef struct {
+	bluObjFunction* function;
+
+	ByteBuffer code;
+
+	// Native offset of each bytecode offset.
+	IntBuffer labels;
+
+	bluJitFixupBuffer jumps;
+	IntBuffer exits;
+} bluAssembler;
+
+typedef void (*bluJitEntry)(bluVM* vm, bluCallFrame* frame, uint8_t* target);
+
+static void emit8(bluAssembler* as, uint8_t byte) {
+	ByteBufferWrite(&as->code, byte);
+}
+
+static void emit32(bluAssembler* as, uint32_t value) {
+	for (int32_t i = 0; i < 4; i++) {
+		emit8(as, (value >> (i * 8)) & 0xff);
+	}
+}
+
+static void emit64(bluAssembler* as, uint64_t value) {
+	for (int32_t i = 0; i < 8; i++) {
+		emit8(as, (value >> (i * 8)) & 0xff);
+	}
+}
+
+static void patch32(bluAssembler* as, int32_t at, int32_t value) {
+	for (int32_t i = 0; i < 4; i++) {
+		as->code.data[at + i] = (value >> (i * 8)) & 0xff;
+	}
+}
+
+static void emitRex(bluAssembler* as, bool wide, int32_t reg, int32_t base) {
+	if (wide || reg >= 8 || base >= 8) {
+		emit8(as, 0x40 | (wide << 3) | ((reg >> 3) << 2) | (base >> 3));
+	}
+}
+
+// Always uses the [base + disp32] form, which works the same for every base register.
+static void emitModRM(bluAssembler* as, int32_t reg, Register base, int32_t disp) {
+	emit8(as, 0x80 | ((reg & 7) << 3) | (base & 7));
+	if ((base & 7) == RSP) emit8(as, 0x24);
+	emit32(as, disp);
+}
+
+static void emitPush(bluAssembler* as, Register reg) {
+	if (reg >= 8) emit8(as, 0x41);
+	emit8(as, 0x50 + (reg & 7));
+}
+
+static void emitPop(bluAssembler* as, Register reg) {
+	if (reg >= 8) emit8(as, 0x41);
+	emit8(as, 0x58 + (reg & 7));
+}
+
+// mov dst, src
+static void emitMov(bluAssembler* as, Register dst, Register src) {
+	emit8(as, 0x48 | ((src >> 3) << 2) | (dst >> 3));
+	emit8(as, 0x89);
+	emit8(as, 0xc0 | ((src & 7) << 3) | (dst & 7));
+}
+
+// mov dst, imm64
+static void emitMovImm(bluAssembler* as, Register dst, uint64_t value) {
+	emit8(as, 0x48 | (dst >> 3));
+	emit8(as, 0xb8 + (dst & 7));
+	emit64(as, value);
+}
+
+// mov dst, qword [base + disp]
+static void emitLoad(bluAssembler* as, Register dst, Register base, int32_t disp) {
+	emitRex(as, true, dst, base);
+	emit8(as, 0x8b);
+	emitModRM(as, dst, base, disp);
+}
+
+// mov qword [base + disp], src
+static void emitStore(bluAssembler* as, Register base, int32_t disp, Register src) {
+	emitRex(as, true, src, base);
+	emit8(as, 0x89);
+	emitModRM(as, src, base, disp);
+}
+
+// mov byte [base + disp], al
+static void emitStoreAl(bluAssembler* as, Register base, int32_t disp) {
+	emitRex(as, false, RAX, base);
+	emit8(as, 0x88);
+	emitModRM(as, RAX, base, disp);
+}
+
+// mov dword [base + disp], imm32
+static void emitStoreImm32(bluAssembler* as, Register base, int32_t disp, uint32_t value) {
+	emitRex(as, false, 0, base);
+	emit8(as, 0xc7);
+	emitModRM(as, 0, base, disp);
+	emit32(as, value);
+}
+
+// lea dst, [base + disp]
+static void emitLea(bluAssembler* as, Register dst, Register base, int32_t disp) {
+	emitRex(as, true, dst, base);
+	emit8(as, 0x8d);
+	emitModRM(as, dst, base, disp);
+}
+
+// add reg, imm32
+static void emitAddImm(bluAssembler* as, Register reg, int32_t value) {
+	emit8(as, 0x48 | (reg >> 3));
+	emit8(as, 0x81);
+	emit8(as, 0xc0 | (reg & 7));
+	emit32(as, value);
+}
+
+// cmp dword [base + disp], imm32
+static void emitCmpImm32(bluAssembler* as, Register base, int32_t disp, uint32_t value) {
+	emitRex(as, false, 0, base);
+	emit8(as, 0x81);
+	emitModRM(as, 7, base, disp);
+	emit32(as, value);
+}
+
+// cmp byte [base + disp], imm8
+static void emitCmpImm8(bluAssembler* as, Register base, int32_t disp, uint8_t value) {
+	emitRex(as, false, 0, base);
+	emit8(as, 0x80);
+	emitModRM(as, 7, base, disp);
+	emit8(as, value);
+}
+
+// btc qword [base + disp], bit
+static void emitBtc(bluAssembler* as, Register base, int32_t disp, uint8_t bit) {
+	emitRex(as, true, 0, base);
+	emit8(as, 0x0f);
+	emit8(as, 0xba);
+	emitModRM(as, 7, base, disp);
+	emit8(as, bit);
+}
+
+// movsd xmm, qword [base + disp]
+static void emitLoadDouble(bluAssembler* as, XmmRegister xmm, Register base, int32_t disp) {
+	emit8(as, 0xf2);
+	emitRex(as, false, xmm, base);
+	emit8(as, 0x0f);
+	emit8(as, 0x10);
+	emitModRM(as, xmm, base, disp);
+}
+
+// movsd qword [base + disp], xmm
+static void emitStoreDouble(bluAssembler* as, Register base, int32_t disp, XmmRegister xmm) {
+	emit8(as, 0xf2);
+	emitRex(as, false, xmm, base);
+	emit8(as, 0x0f);
+	emit8(as, 0x11);
+	emitModRM(as, xmm, base, disp);
+}
+
+// addsd/subsd/mulsd/divsd dst, src
+static void emitDoubleOp(bluAssembler* as, uint8_t opcode, XmmRegister dst, XmmRegister src) {
+	emit8(as, 0xf2);
+	emit8(as, 0x0f);
+	emit8(as, opcode);
+	emit8(as, 0xc0 | (dst << 3) | src);
+}
+
+// ucomisd a, b
+static void emitCompareDouble(bluAssembler* as, XmmRegister a, XmmRegister b) {
+	emit8(as, 0x66);
+	emit8(as, 0x0f);
+	emit8(as, 0x2e);
+	emit8(as, 0xc0 | (a << 3) | b);
+}
+
+// setcc al
+static void emitSetAl(bluAssembler* as, Condition condition) {
+	emit8(as, 0x0f);
+	emit8(as, 0x90 | condition);
+	emit8(as, 0xc0);
+}
+
+// mov rax, function; call rax
+static void emitCall(bluAssembler* as, void* function) {
+	emitMovImm(as, RAX, (uint64_t)(uintptr_t)function);
+	emit8(as, 0xff);
+	emit8(as, 0xd0);
+}
+
+// test al, al
+static void emitTestAl(bluAssembler* as) {
+	emit8(as, 0x84);
+	emit8(as, 0xc0);
+}
+
+// Emits a jump with an empty rel32 operand and returns the offset of the operand.
+static int32_t emitJump(bluAssembler* as) {
+	emit8(as, 0xe9);
+	emit32(as, 0);
+
+	return as->code.count - 4;
+}
+
+static int32_t emitJumpIf(bluAssembler* as, Condition condition) {
+	emit8(as, 0x0f);
+	emit8(as, 0x80 | condition);
+	emit32(as, 0);
+
+	return as->code.count - 4;
+}
+
+// Points the rel32 operand at [at] to the current end of the code.
+static void patchJump(bluAssembler* as, int32_t at) {
+	patch32(as, at, as->code.count - (at + 4));
+}
+
+static void jumpTo(bluAssembler* as, int32_t at, int32_t target) {
+	bluJitFixup fixup;
+	fixup.at = at;
+	fixup.target = target;
+
+	bluJitFixupBufferWrite(&as->jumps, fixup);
+}
+
+// Hands the instruction at [offset] over to the interpreter.
+static void emitExit(bluAssembler* as, int32_t offset) {
+	emitMovImm(as, RAX, (uint64_t)(uintptr_t)(as->function->chunk.code.data + offset));
+	IntBufferWrite(&as->exits, emitJump(as));
+}
+
+// Emits a jump over an exit of the instruction at [offset], which guards that fail jump to. Returns the offset of the
+// guard target.
+static int32_t emitSlowPath(bluAssembler* as, int32_t offset) {
+	int32_t done = emitJump(as);
+	int32_t slowPath = as->code.count;
+
+	emitExit(as, offset);
+	patchJump(as, done);
+
+	return slowPath;
+}
+
+static void guardNumber(bluAssembler* as, IntBuffer* guards, Register base, int32_t disp) {
+	emitCmpImm32(as, base, disp, VAL_NUMBER);
+	IntBufferWrite(guards, emitJumpIf(as, CC_NE));
+}
+
+static void patchGuards(bluAssembler* as, IntBuffer* guards, int32_t target) {
+	for (int32_t i = 0; i < guards->count; i++) {
+		patch32(as, guards->data[i], target - (guards->data[i] + 4));
+	}
+}
+
+static void pushValue(bluAssembler* as, bluValue value) {
+	uint64_t payload = 0;
+	memcpy(&payload, &value.as, sizeof(value.as));
+
+	emitStoreImm32(as, REG_TOP, TYPE_OFFSET, value.type);
+	emitMovImm(as, RAX, payload);
+	emitStore(as, REG_TOP, AS_OFFSET, RAX);
+	emitAddImm(as, REG_TOP, VALUE_SIZE);
+}
+
+// Copies the value at [srcBase + srcDisp] to [dstBase + dstDisp].
+static void copyValue(bluAssembler* as, Register dstBase, int32_t dstDisp, Register srcBase, int32_t srcDisp) {
+	emitLoad(as, RAX, srcBase, srcDisp);
+	emitLoad(as, RCX, srcBase, srcDisp + 8);
+	emitStore(as, dstBase, dstDisp, RAX);
+	emitStore(as, dstBase, dstDisp + 8, RCX);
+}
+
+// Loads the address of upvalue [slot]'s value into rdx.
+static void loadUpvalue(bluAssembler* as, int32_t slot) {
+	emitLoad(as, RDX, REG_FRAME, offsetof(bluCallFrame, closure));
+	emitLoad(as, RDX, RDX, offsetof(bluObjClosure, upvalues) + offsetof(bluObjUpvalueBuffer, data));
+	emitLoad(as, RDX, RDX, slot * (int32_t)sizeof(bluObjUpvalue*));
+	emitLoad(as, RDX, RDX, offsetof(bluObjUpvalue, value));
+}
+
+static bool jitGetGlobal(bluVM* vm, bluObjString* name, bluValue* value) {
+	return bluTableGet(vm, &vm->globals, name, value);
+}
+
+static void jitEqual(bluValue* left, bluValue* right, bluValue* result) {
+	*result = BOOL_VAL(bluValuesEqual(*left, *right));
+}
+
+static void jitNotEqual(bluValue* left, bluValue* right, bluValue* result) {
+	*result = BOOL_VAL(!bluValuesEqual(*left, *right));
+}
+
+static void jitNot(bluValue* value) {
+	*value = BOOL_VAL(bluIsFalsey(*value));
+}
+
+// Binary operators on two numbers on top of the stack. Comparisons are done so that NaN operands are never ordered.
+static void emitBinary(bluAssembler* as, int32_t offset, bluOpCode op) {
+	IntBuffer guards;
+	IntBufferInit(&guards);
+
+	guardNumber(as, &guards, REG_TOP, PEEK_TYPE(1));
+	guardNumber(as, &guards, REG_TOP, PEEK_TYPE(0));
+
+	emitLoadDouble(as, XMM0, REG_TOP, PEEK_AS(1));
+	emitLoadDouble(as, XMM1, REG_TOP, PEEK_AS(0));
+
+	switch (op) {
+	case OP_ADD: emitDoubleOp(as, 0x58, XMM0, XMM1); break;
+	case OP_MULTIPLY: emitDoubleOp(as, 0x59, XMM0, XMM1); break;
+	case OP_SUBTRACT: emitDoubleOp(as, 0x5c, XMM0, XMM1); break;
+	case OP_DIVIDE: emitDoubleOp(as, 0x5e, XMM0, XMM1); break;
+	case OP_GREATER: emitCompareDouble(as, XMM0, XMM1); emitSetAl(as, CC_A); break;
+	case OP_GREATER_EQUAL: emitCompareDouble(as, XMM0, XMM1); emitSetAl(as, CC_AE); break;
+	case OP_LESS: emitCompareDouble(as, XMM1, XMM0); emitSetAl(as, CC_A); break;
+	case OP_LESS_EQUAL: emitCompareDouble(as, XMM1, XMM0); emitSetAl(as, CC_AE); break;
+	default: __builtin_unreachable();
+	}
+
+	switch (op) {
+	case OP_ADD:
+	case OP_MULTIPLY:
+	case OP_SUBTRACT:
+	case OP_DIVIDE: emitStoreDouble(as, REG_TOP, PEEK_AS(1), XMM0); break;
+
+	default:
+		emitStoreImm32(as, REG_TOP, PEEK_TYPE(1), VAL_BOOL);
+		emitStoreAl(as, REG_TOP, PEEK_AS(1));
+		break;
+	}
+
+	emitAddImm(as, REG_TOP, -VALUE_SIZE);
+
+	patchGuards(as, &guards, emitSlowPath(as, offset));
+	IntBufferFree(&guards);
+}
+
+#ifdef BLU_REGISTER_VM
+static uint16_t readShort(bluChunk* chunk, int32_t offset) {
+	return (uint16_t)((chunk->code.data[offset] << 8) | chunk->code.data[offset + 1]);
+}
+
+// Loads the address of a register operand into [reg].
+static void loadRegisterAddress(bluAssembler* as, Register reg, uint16_t operand) {
+	if (operand & RK_CONSTANT) {
+		bluValue* constant = &as->function->chunk.constants.data[operand & RK_MAX];
+		emitMovImm(as, reg, (uint64_t)(uintptr_t)constant);
+	} else {
+		emitLea(as, reg, REG_SLOTS, operand * VALUE_SIZE);
+	}
+}
+
+// Loads a number register operand into [xmm]. Returns false if the operand is a constant which is not a number.
+static bool loadRegisterNumber(bluAssembler* as, IntBuffer* guards, XmmRegister xmm, uint16_t operand) {
+	if (operand & RK_CONSTANT) {
+		bluValue* constant = &as->function->chunk.constants.data[operand & RK_MAX];
+		if (!IS_NUMBER(*constant)) return false;
+
+		emitMovImm(as, RAX, (uint64_t)(uintptr_t)constant);
+		emitLoadDouble(as, xmm, RAX, AS_OFFSET);
+	} else {
+		guardNumber(as, guards, REG_SLOTS, operand * VALUE_SIZE + TYPE_OFFSET);
+		emitLoadDouble(as, xmm, REG_SLOTS, operand * VALUE_SIZE + AS_OFFSET);
+	}
+
+	return true;
+}
+
+static void emitRegisterBinary(bluAssembler* as, int32_t offset, bluOpCode op) {
+	uint16_t left = readShort(&as->function->chunk, offset + 1);
+	uint16_t right = readShort(&as->function->chunk, offset + 3);
+
+	if (op == OP_EQUAL_RK || op == OP_NOT_EQUAL_RK) {
+		loadRegisterAddress(as, RDI, left);
+		loadRegisterAddress(as, RSI, right);
+		emitMov(as, RDX, REG_TOP);
+		emitCall(as, op == OP_EQUAL_RK ? (void*)jitEqual : (void*)jitNotEqual);
+		emitAddImm(as, REG_TOP, VALUE_SIZE);
+		return;
+	}
+
+	IntBuffer guards;
+	IntBufferInit(&guards);
+
+	if (!loadRegisterNumber(as, &guards, XMM0, left) || !loadRegisterNumber(as, &guards, XMM1, right)) {
+		IntBufferFree(&guards);
+		emitExit(as, offset);
+		return;
+	}
+
+	switch (op) {
+	case OP_ADD_RK: emitDoubleOp(as, 0x58, XMM0, XMM1); break;
+	case OP_MULTIPLY_RK: emitDoubleOp(as, 0x59, XMM0, XMM1); break;
+	case OP_SUBTRACT_RK: emitDoubleOp(as, 0x5c, XMM0, XMM1); break;
+	case OP_DIVIDE_RK: emitDoubleOp(as, 0x5e, XMM0, XMM1); break;
+	case OP_GREATER_RK: emitCompareDouble(as, XMM0, XMM1); emitSetAl(as, CC_A); break;
+	case OP_GREATER_EQUAL_RK: emitCompareDouble(as, XMM0, XMM1); emitSetAl(as, CC_AE); break;
+	case OP_LESS_RK: emitCompareDouble(as, XMM1, XMM0); emitSetAl(as, CC_A); break;
+	case OP_LESS_EQUAL_RK: emitCompareDouble(as, XMM1, XMM0); emitSetAl(as, CC_AE); break;
+	default: __builtin_unreachable();
+	}
+
+	switch (op) {
+	case OP_ADD_RK:
+	case OP_MULTIPLY_RK:
+	case OP_SUBTRACT_RK:
+	case OP_DIVIDE_RK:
+		emitStoreImm32(as, REG_TOP, TYPE_OFFSET, VAL_NUMBER);
+		emitStoreDouble(as, REG_TOP, AS_OFFSET, XMM0);
+		break;
+
+	default:
+		emitStoreImm32(as, REG_TOP, TYPE_OFFSET, VAL_BOOL);
+		emitStoreAl(as, REG_TOP, AS_OFFSET);
+		break;
+	}
+
+	emitAddImm(as, REG_TOP, VALUE_SIZE);
+
+	patchGuards(as, &guards, emitSlowPath(as, offset));
+	IntBufferFree(&guards);
+}
+#endif
+
+// Jumps to the bytecode offset [target] when the value on top of the stack is falsey, or truthy if [ifTrue] is set.
+static void emitConditionalJump(bluAssembler* as, int32_t target, bool ifTrue) {
+	emitCmpImm32(as, REG_TOP, PEEK_TYPE(0), VAL_BOOL);
+	int32_t notBool = emitJumpIf(as, CC_NE);
+
+	// Booleans branch on their value.
+	emitCmpImm8(as, REG_TOP, PEEK_AS(0), 0);
+	jumpTo(as, emitJumpIf(as, ifTrue ? CC_NE : CC_E), target);
+	int32_t done = emitJump(as);
+
+	// Nil is the only other falsey value.
+	patchJump(as, notBool);
+	emitCmpImm32(as, REG_TOP, PEEK_TYPE(0), VAL_NIL);
+	jumpTo(as, emitJumpIf(as, ifTrue ? CC_NE : CC_E), target);
+
+	patchJump(as, done);
+}
+
+static void emitInstruction(bluAssembler* as, int32_t offset) {
+	bluChunk* chunk = &as->function->chunk;
+	uint8_t* code = chunk->code.data;
+
+	uint16_t operand = 0;
+	if (bluInstructionLength(chunk, offset) >= 3) {
+		operand = (uint16_t)((code[offset + 1] << 8) | code[offset + 2]);
+	}
+
+	switch (code[offset]) {
+
+	case OP_CONSTANT: {
+		pushValue(as, chunk->constants.data[operand]);
+		break;
+	}
+
+	case OP_FALSE: pushValue(as, BOOL_VAL(false)); break;
+	case OP_NIL: pushValue(as, NIL_VAL); break;
+	case OP_TRUE: pushValue(as, BOOL_VAL(true)); break;
+
+	case OP_POP: {
+		emitAddImm(as, REG_TOP, -VALUE_SIZE);
+		break;
+	}
+
+	case OP_GET_LOCAL: {
+		copyValue(as, REG_TOP, 0, REG_SLOTS, operand * VALUE_SIZE);
+		emitAddImm(as, REG_TOP, VALUE_SIZE);
+		break;
+	}
+
+	case OP_SET_LOCAL: {
+		copyValue(as, REG_SLOTS, operand * VALUE_SIZE, REG_TOP, -VALUE_SIZE);
+		break;
+	}
+
+	case OP_GET_GLOBAL: {
+		emitMov(as, RDI, REG_VM);
+		emitMovImm(as, RSI, (uint64_t)(uintptr_t)AS_STRING(chunk->constants.data[operand]));
+		emitMov(as, RDX, REG_TOP);
+		emitCall(as, jitGetGlobal);
+		emitTestAl(as);
+
+		// Undefined globals are reported by the interpreter.
+		int32_t undefined = emitJumpIf(as, CC_E);
+		emitAddImm(as, REG_TOP, VALUE_SIZE);
+		patch32(as, undefined, emitSlowPath(as, offset) - (undefined + 4));
+		break;
+	}
+
+	case OP_GET_UPVALUE: {
+		loadUpvalue(as, operand);
+		copyValue(as, REG_TOP, 0, RDX, 0);
+		emitAddImm(as, REG_TOP, VALUE_SIZE);
+		break;
+	}
+
+	case OP_SET_UPVALUE: {
+		loadUpvalue(as, operand);
+		copyValue(as, RDX, 0, REG_TOP, -VALUE_SIZE);
+		break;
+	}
+
+	case OP_JUMP: {
+		jumpTo(as, emitJump(as), offset + 3 + operand);
+		break;
+	}
+
+	case OP_JUMP_IF_FALSE: {
+		emitConditionalJump(as, offset + 3 + operand, false);
+		break;
+	}
+
+	case OP_JUMP_IF_TRUE: {
+		emitConditionalJump(as, offset + 3 + operand, true);
+		break;
+	}
+
+	case OP_LOOP: {
+		// A pending sample of the profiler is taken by the interpreter, long running loops would hide it otherwise.
+		emitCmpImm32(as, REG_VM, offsetof(bluVM, shouldSample), 0);
+		jumpTo(as, emitJumpIf(as, CC_E), offset + 3 - operand);
+		emitExit(as, offset);
+		break;
+	}
+
+	case OP_EQUAL:
+	case OP_NOT_EQUAL: {
+		emitLea(as, RDI, REG_TOP, -2 * VALUE_SIZE);
+		emitLea(as, RSI, REG_TOP, -VALUE_SIZE);
+		emitMov(as, RDX, RDI);
+		emitCall(as, code[offset] == OP_EQUAL ? (void*)jitEqual : (void*)jitNotEqual);
+		emitAddImm(as, REG_TOP, -VALUE_SIZE);
+		break;
+	}
+
+	case OP_GREATER:
+	case OP_GREATER_EQUAL:
+	case OP_LESS:
+	case OP_LESS_EQUAL:
+	case OP_ADD:
+	case OP_DIVIDE:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY: {
+		emitBinary(as, offset, code[offset]);
+		break;
+	}
+
+	// Quickened instructions get the same template. When its guard fails, the interpreter deoptimizes the instruction.
+	case OP_GREATER_NUM: emitBinary(as, offset, OP_GREATER); break;
+	case OP_GREATER_EQUAL_NUM: emitBinary(as, offset, OP_GREATER_EQUAL); break;
+	case OP_LESS_NUM: emitBinary(as, offset, OP_LESS); break;
+	case OP_LESS_EQUAL_NUM: emitBinary(as, offset, OP_LESS_EQUAL); break;
+	case OP_ADD_NUM: emitBinary(as, offset, OP_ADD); break;
+	case OP_DIVIDE_NUM: emitBinary(as, offset, OP_DIVIDE); break;
+	case OP_SUBTRACT_NUM: emitBinary(as, offset, OP_SUBTRACT); break;
+	case OP_MULTIPLY_NUM: emitBinary(as, offset, OP_MULTIPLY); break;
+
+	case OP_NOT: {
+		emitLea(as, RDI, REG_TOP, -VALUE_SIZE);
+		emitCall(as, jitNot);
+		break;
+	}
+
+	case OP_NEGATE: {
+		IntBuffer guards;
+		IntBufferInit(&guards);
+
+		guardNumber(as, &guards, REG_TOP, PEEK_TYPE(0));
+		emitBtc(as, REG_TOP, PEEK_AS(0), 63);
+
+		patchGuards(as, &guards, emitSlowPath(as, offset));
+		IntBufferFree(&guards);
+		break;
+	}
+
+#ifdef BLU_REGISTER_VM
+	case OP_EQUAL_RK:
+	case OP_NOT_EQUAL_RK:
+	case OP_GREATER_RK:
+	case OP_GREATER_EQUAL_RK:
+	case OP_LESS_RK:
+	case OP_LESS_EQUAL_RK:
+	case OP_ADD_RK:
+	case OP_DIVIDE_RK:
+	case OP_SUBTRACT_RK:
+	case OP_MULTIPLY_RK: {
+		emitRegisterBinary(as, offset, code[offset]);
+		break;
+	}
+#endif
+
+	default: {
+		emitExit(as, offset);
+		break;
+	}
+	}
+}
+
+void bluJitCompile(bluVM* vm, bluObjFunction* function) {
+	bluChunk* chunk = &function->chunk;
+
+	bluAssembler as;
+	as.function = function;
+	ByteBufferInit(&as.code);
+	IntBufferInit(&as.labels);
+	bluJitFixupBufferInit(&as.jumps);
+	IntBufferInit(&as.exits);
+
+	IntBufferFill(&as.labels, -1, chunk->code.count);
+
+	// The entry takes (vm, frame, target), loads the pinned registers and jumps to the target.
+	emitPush(&as, RBX);
+	emitPush(&as, R12);
+	emitPush(&as, R13);
+	emitPush(&as, R14);
+	emitPush(&as, R15);
+	emitMov(&as, REG_VM, RDI);
+	emitMov(&as, REG_FRAME, RSI);
+	emitLoad(&as, REG_SLOTS, REG_FRAME, offsetof(bluCallFrame, slots));
+	emitLoad(&as, REG_TOP, REG_VM, offsetof(bluVM, stackTop));
+	emit8(&as, 0xff);
+	emit8(&as, 0xe2); // jmp rdx
+
+	for (int32_t offset = 0; offset < chunk->code.count; offset += bluInstructionLength(chunk, offset)) {
+		as.labels.data[offset] = as.code.count;
+		emitInstruction(&as, offset);
+	}
+
+	// Every exit jumps here with the address of the instruction to continue with in rax.
+	int32_t exit = as.code.count;
+	emitStore(&as, REG_FRAME, offsetof(bluCallFrame, ip), RAX);
+	emitStore(&as, REG_VM, offsetof(bluVM, stackTop), REG_TOP);
+	emitPop(&as, R15);
+	emitPop(&as, R14);
+	emitPop(&as, R13);
+	emitPop(&as, R12);
+	emitPop(&as, RBX);
+	emit8(&as, 0xc3); // ret
+
+	for (int32_t i = 0; i < as.exits.count; i++) {
+		patch32(&as, as.exits.data[i], exit - (as.exits.data[i] + 4));
+	}
+
+	for (int32_t i = 0; i < as.jumps.count; i++) {
+		bluJitFixup* jump = &as.jumps.data[i];
+		patch32(&as, jump->at, as.labels.data[jump->target] - (jump->at + 4));
+	}
+
+	size_t size = as.code.count;
+	uint8_t* code = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (code != MAP_FAILED) {
+		memcpy(code, as.code.data, size);
+
+		if (mprotect(code, size, PROT_READ | PROT_EXEC) == 0) {
+			bluJitCode* jit = malloc(sizeof(bluJitCode));
+			jit->code = code;
+			jit->size = size;
+			jit->entries = as.labels.data;
+
+			function->jit = jit;
+
+			// The labels are now owned by the compiled code.
+			IntBufferInit(&as.labels);
+		} else {
+			munmap(code, size);
+		}
+	}
+
+	ByteBufferFree(&as.code);
+	IntBufferFree(&as.labels);
+	bluJitFixupBufferFree(&as.jumps);
+	IntBufferFree(&as.exits);
+}
+
+void bluJitEnter(bluVM* vm, bluCallFrame* frame, bluJitCode* jit) {
+	int32_t offset = frame->ip - frame->closure->function->chunk.code.data;
+
+	bluJitEntry entry = (bluJitEntry)(uintptr_t)jit->code;
+	entry(vm, frame, jit->code + jit->entries[offset]);
+}
+
+void bluJitFree(bluObjFunction* function) {
+	if (function->jit == NULL) return;
+
+	munmap(function->jit->code, function->jit->size);
+	free(function->jit->entries);
+	free(function->jit);
+
+	function->jit = NULL;
+}
+
+#endif
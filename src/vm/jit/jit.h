@@ -0,0 +1,38 @@
+#ifndef blu_jit_h
+#define blu_jit_h
+
+#include "include/blu.h"
+#include "vm/common.h"
+#include "vm/vm.h"
+
+#ifdef BLU_JIT
+
+// Number of calls and loop iterations after which a function gets compiled to native code.
+#ifdef DEBUG_JIT_STRESS
+#define JIT_THRESHOLD 1
+#else
+#define JIT_THRESHOLD 1000
+#endif
+
+struct bluJitCode {
+	// Executable mapping holding the native code.
+	uint8_t* code;
+	size_t size;
+
+	// Offset of the native code for each bytecode offset, or -1 when the offset is not an instruction boundary.
+	int32_t* entries;
+};
+
+// Compiles [function] to native code. The native code keeps the value stack and the call frame in exactly the same
+// state the interpreter would, so the interpreter can take over at any instruction.
+void bluJitCompile(bluVM* vm, bluObjFunction* function);
+
+// Runs native code of [frame]'s function from the current frame->ip until it reaches an instruction it has no fast path
+// for. frame->ip and vm->stackTop are then left pointing at that instruction, ready to be executed by the interpreter.
+void bluJitEnter(bluVM* vm, bluCallFrame* frame, bluJitCode* jit);
+
+void bluJitFree(bluObjFunction* function);
+
+#endif
+
+#endif
@@ -1,4 +1,5 @@
 #include "core.h"
+#include "util/format.h"
 #include "vm/memory.h"
 #include "vm/value.h"
 #include "vm/vm.h"
@@ -49,6 +50,15 @@ int8_t Number_ceil(bluVM* vm, int8_t argCount, bluValue* args) {
 	return 1;
 }
 
+int8_t Number_toString(bluVM* vm, int8_t argCount, bluValue* args) {
+	char chars[NUMBER_FORMAT_MAX];
+	int32_t length = bluFormatNumber(AS_NUMBER(args[0]), chars);
+
+	args[0] = OBJ_VAL(bluCopyString(vm, chars, length));
+
+	return 1;
+}
+
 int8_t Array_push(bluVM* vm, int8_t argCount, bluValue* args) {
 	bluObjArray* array = AS_ARRAY(args[0]);
 	bluValue value = args[1];
@@ -110,9 +120,12 @@ int8_t String_reverse(bluVM* vm, int8_t argCount, bluValue* args) {
 int8_t String_toNumber(bluVM* vm, int8_t argCount, bluValue* args) {
 	bluObjString* string = AS_STRING(args[0]);
 
-	double number = atof(string->chars);
-
-	args[0] = NUMBER_VAL(number);
+	double number;
+	if (bluParseNumber(string->chars, string->length, &number)) {
+		args[0] = NUMBER_VAL(number);
+	} else {
+		args[0] = NIL_VAL;
+	}
 
 	return 1;
 }
@@ -175,9 +188,51 @@ int8_t String_substring(bluVM* vm, int8_t argCount, bluValue* args) {
 	return 1;
 }
 
+int8_t Fiber__new(bluVM* vm, int8_t argCount, bluValue* args) {
+	bluValue callee = args[1];
+
+	if (!IS_CLOSURE(callee) && !IS_BOUND_METHOD(callee)) return -1;
+
+	args[0] = OBJ_VAL(bluNewFiber(vm, callee));
+
+	return 1;
+}
+
+// Switching fibers is left to the VM, which does it as soon as these return.
+int8_t Fiber__yield(bluVM* vm, int8_t argCount, bluValue* args) {
+	vm->yielded = true;
+	vm->transfer = argCount > 0 ? args[1] : NIL_VAL;
+
+	args[0] = NIL_VAL;
+
+	return 1;
+}
+
+int8_t Fiber_resume(bluVM* vm, int8_t argCount, bluValue* args) {
+	vm->resumed = AS_FIBER(args[0]);
+	vm->transfer = argCount > 0 ? args[1] : NIL_VAL;
+
+	args[0] = NIL_VAL;
+
+	return 1;
+}
+
+int8_t Fiber_isDone(bluVM* vm, int8_t argCount, bluValue* args) {
+	args[0] = BOOL_VAL(AS_FIBER(args[0])->state == FIBER_DONE);
+
+	return 1;
+}
+
 void bluInitCore(bluVM* vm) {
+	// The core is the first script the VM runs, but not the one its startup is traced up to.
+	bluStartupHook startupHook = vm->startupHook;
+	vm->startupHook = NULL;
+
 	bluInterpret(vm, coreSource, "__CORE__");
 
+	vm->startupHook = startupHook;
+	bluTraceStartup(vm, BLU_STARTUP_CORE_COMPILED);
+
 	bluObj* objectClass = bluGetGlobal(vm, "Object");
 	bluDefineMethod(vm, objectClass, "getClass", Object_getClass, 0);
 	bluDefineMethod(vm, objectClass, "isFalsey", Object_isFalsey, 0);
@@ -192,6 +247,7 @@ void bluInitCore(bluVM* vm) {
 	bluObj* numberClass = bluGetGlobal(vm, "Number");
 	bluDefineMethod(vm, numberClass, "floor", Number_floor, 0);
 	bluDefineMethod(vm, numberClass, "ceil", Number_ceil, 0);
+	bluDefineMethod(vm, numberClass, "toString", Number_toString, 0);
 	vm->numberClass = (bluObjClass*)numberClass;
 
 	bluObj* arrayClass = bluGetGlobal(vm, "Array");
@@ -214,4 +270,13 @@ void bluInitCore(bluVM* vm) {
 	bluDefineMethod(vm, stringClass, "at", String_at, 1);
 	bluDefineMethod(vm, stringClass, "substring", String_substring, 2);
 	vm->stringClass = (bluObjClass*)stringClass;
+
+	bluObj* fiberClass = bluGetGlobal(vm, "Fiber");
+	bluDefineStaticMethod(vm, fiberClass, "new", Fiber__new, 1);
+	bluDefineStaticMethod(vm, fiberClass, "yield", Fiber__yield, 0);
+	bluDefineMethod(vm, fiberClass, "resume", Fiber_resume, 0);
+	bluDefineMethod(vm, fiberClass, "isDone", Fiber_isDone, 0);
+	vm->fiberClass = (bluObjClass*)fiberClass;
+
+	bluTraceStartup(vm, BLU_STARTUP_CORE_NATIVES);
 }
@@ -0,0 +1,645 @@
+#include "event.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "vm/memory.h"
+#include "vm/object.h"
+#include "vm/value.h"
+#include "vm/vm.h"
+
+#include "event.blu.inc"
+
+// Most events taken from the kernel by one poll().
+#define EVENT_BATCH 64
+
+// Each descriptor is registered with epoll once, for the union of the events its waits are for.
+typedef struct {
+	// Events the descriptor is registered for, 0 while it isn't.
+	uint32_t events;
+
+	// Slots of the waits for the descriptor to become readable and writable, -1 when there are none.
+	int32_t readers;
+	int32_t writers;
+
+	// Timers own their descriptor, it's closed once they fire.
+	bool isTimer;
+} bluRegistration;
+
+DECLARE_BUFFER(bluRegistration, bluRegistration);
+DEFINE_BUFFER(bluRegistration, bluRegistration);
+
+typedef struct {
+	int epoll;
+
+	// Indexed by descriptor.
+	bluRegistrationBuffer registrations;
+
+	// Each wait has a slot. The fiber waiting in it is kept in the same slot of the [_waiting] array of the loop, where
+	// the GC can see it. Waits for the same descriptor and direction are linked through [nextWaits].
+	IntBuffer nextWaits;
+	IntBuffer freeSlots;
+
+	int32_t pending;
+} LoopData;
+
+typedef struct {
+	int fd;
+
+	// Path of a listening Unix socket, removed when the stream is closed.
+	char* path;
+} StreamData;
+
+static void constructLoop(bluVM* vm, bluObjInstance* instance) {
+	LoopData* loop = bluAllocate(vm, sizeof(LoopData));
+	loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+	loop->pending = 0;
+
+	bluRegistrationBufferInit(&loop->registrations);
+	IntBufferInit(&loop->nextWaits);
+	IntBufferInit(&loop->freeSlots);
+
+	instance->data = loop;
+}
+
+static void destructLoop(bluVM* vm, bluObjInstance* instance) {
+	LoopData* loop = instance->data;
+
+	// Timers which haven't fired yet still own their descriptor.
+	for (int32_t fd = 0; fd < loop->registrations.count; fd++) {
+		if (loop->registrations.data[fd].isTimer && loop->registrations.data[fd].events != 0) close(fd);
+	}
+
+	close(loop->epoll);
+
+	bluRegistrationBufferFree(&loop->registrations);
+	IntBufferFree(&loop->nextWaits);
+	IntBufferFree(&loop->freeSlots);
+
+	bluDeallocate(vm, loop, sizeof(LoopData));
+}
+
+static void closeStream(StreamData* stream) {
+	if (stream->fd != -1) close(stream->fd);
+	stream->fd = -1;
+
+	if (stream->path != NULL) {
+		unlink(stream->path);
+		free(stream->path);
+	}
+
+	stream->path = NULL;
+}
+
+static void destructStream(bluVM* vm, bluObjInstance* instance) {
+	StreamData* stream = instance->data;
+	if (stream == NULL) return;
+
+	closeStream(stream);
+
+	bluDeallocate(vm, stream, sizeof(StreamData));
+}
+
+static bluObjInstance* newStream(bluVM* vm, int fd) {
+	bluObjInstance* instance = bluNewInstance(vm, (bluObjClass*)bluGetGlobal(vm, "Stream"));
+
+	StreamData* stream = bluAllocate(vm, sizeof(StreamData));
+	stream->fd = fd;
+	stream->path = NULL;
+
+	instance->data = stream;
+
+	return instance;
+}
+
+static int streamFd(bluValue value) {
+	StreamData* stream = AS_INSTANCE(value)->data;
+
+	return stream != NULL ? stream->fd : -1;
+}
+
+static bluObjArray* waitingFibers(bluVM* vm, bluObjInstance* loop) {
+	bluValue value;
+	bluTableGet(vm, &loop->fields, bluCopyString(vm, "_waiting", strlen("_waiting")), &value);
+
+	return AS_ARRAY(value);
+}
+
+static bluRegistration* registrationOf(LoopData* loop, int fd) {
+	if (fd >= loop->registrations.count) {
+		bluRegistration empty = {.events = 0, .readers = -1, .writers = -1, .isTimer = false};
+		bluRegistrationBufferFill(&loop->registrations, empty, fd + 1 - loop->registrations.count);
+	}
+
+	return &loop->registrations.data[fd];
+}
+
+// Registers [fd] for the events its waits are for, or removes it from epoll once there are none.
+static bool updateRegistration(LoopData* loop, int fd, bluRegistration* registration) {
+	uint32_t events = (registration->readers != -1 ? EPOLLIN : 0) | (registration->writers != -1 ? EPOLLOUT : 0);
+
+	if (events == 0) {
+		if (registration->events != 0) epoll_ctl(loop->epoll, EPOLL_CTL_DEL, fd, NULL);
+
+		registration->events = 0;
+		return true;
+	}
+
+	// One shot, so a descriptor that stays ready doesn't wake the loop again before its fibers had a chance to run.
+	struct epoll_event event = {.events = events | EPOLLONESHOT, .data.fd = fd};
+	int operation = registration->events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+	if (epoll_ctl(loop->epoll, operation, fd, &event) == -1) {
+		// Closing a descriptor removes it from epoll, the number may belong to a new one by now.
+		if (errno != ENOENT || epoll_ctl(loop->epoll, EPOLL_CTL_ADD, fd, &event) == -1) return false;
+	}
+
+	registration->events = events;
+	return true;
+}
+
+// Registers the running fiber to be resumed once [fd] is ready, and suspends it as soon as the calling native returns.
+static bool suspendOn(bluVM* vm, bluObjInstance* instance, int fd, uint32_t events, bool isTimer) {
+	LoopData* loop = instance->data;
+	bluObjArray* waiting = waitingFibers(vm, instance);
+
+	int32_t slot;
+	if (loop->freeSlots.count > 0) {
+		slot = loop->freeSlots.data[--loop->freeSlots.count];
+	} else {
+		slot = IntBufferWrite(&loop->nextWaits, -1);
+
+		if (waiting->len == waiting->cap) {
+			int32_t newCap = waiting->cap == 0 ? 8 : bluPowerOf2Ceil(waiting->cap * 2);
+
+			waiting->data =
+			    bluReallocate(vm, waiting->data, sizeof(bluValue) * waiting->cap, sizeof(bluValue) * newCap);
+			waiting->cap = newCap;
+		}
+
+		waiting->data[waiting->len++] = NIL_VAL;
+	}
+
+	bluRegistration* registration = registrationOf(loop, fd);
+	int32_t* waits = events == EPOLLOUT ? &registration->writers : &registration->readers;
+
+	loop->nextWaits.data[slot] = *waits;
+	*waits = slot;
+
+	if (!updateRegistration(loop, fd, registration)) {
+		*waits = loop->nextWaits.data[slot];
+		IntBufferWrite(&loop->freeSlots, slot);
+		return false;
+	}
+
+	registration->isTimer = isTimer;
+	waiting->data[slot] = OBJ_VAL(vm->fiber);
+	loop->pending++;
+
+	vm->yielded = true;
+	vm->transfer = NIL_VAL;
+
+	return true;
+}
+
+// Moves the slots of [waits] to [woken] and empties the list.
+static void takeWaits(LoopData* loop, int32_t* waits, IntBuffer* woken) {
+	for (int32_t slot = *waits; slot != -1; slot = loop->nextWaits.data[slot]) {
+		IntBufferWrite(woken, slot);
+	}
+
+	*waits = -1;
+}
+
+// Takes the fibers out of the [woken] slots, frees the slots and returns the fibers.
+static bluObjArray* wakeFibers(bluVM* vm, bluObjInstance* instance, IntBuffer* woken) {
+	LoopData* loop = instance->data;
+
+	// The fibers stay in their slots, where the GC sees them, until the array is made.
+	bluObjArray* waiting = waitingFibers(vm, instance);
+	bluObjArray* fibers = bluNewArray(vm, woken->count);
+
+	for (int32_t i = 0; i < woken->count; i++) {
+		int32_t slot = woken->data[i];
+
+		fibers->data[i] = waiting->data[slot];
+		waiting->data[slot] = NIL_VAL;
+
+		IntBufferWrite(&loop->freeSlots, slot);
+	}
+
+	loop->pending -= woken->count;
+
+	return fibers;
+}
+
+// Outside of a fiber there is nothing else to run, so waiting just blocks.
+static bool block(int fd, int16_t events) {
+	struct pollfd descriptor = {.fd = fd, .events = events};
+
+	while (poll(&descriptor, 1, -1) == -1) {
+		if (errno != EINTR) return false;
+	}
+
+	return true;
+}
+
+int8_t Loop_wait(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_NUMBER(args[1])) return -1;
+
+	int fd = AS_NUMBER(args[1]);
+	bool writable = argCount > 1 && !bluIsFalsey(args[2]);
+
+	bluObjInstance* loop = AS_INSTANCE(args[0]);
+	args[0] = NIL_VAL;
+
+	if (vm->fiber == NULL) return block(fd, writable ? POLLOUT : POLLIN) ? 1 : -1;
+
+	if (!suspendOn(vm, loop, fd, writable ? EPOLLOUT : EPOLLIN, false)) {
+		// Regular files can't be polled, they are always ready.
+		return errno == EPERM ? 1 : -1;
+	}
+
+	return 1;
+}
+
+int8_t Loop_sleep(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_NUMBER(args[1])) return -1;
+
+	double seconds = AS_NUMBER(args[1]) > 0 ? AS_NUMBER(args[1]) : 0;
+
+	// A timer set to zero is disarmed, the shortest sleep is a nanosecond.
+	struct timespec duration = {.tv_sec = (time_t)seconds, .tv_nsec = (long)((seconds - (time_t)seconds) * 1e9)};
+	if (duration.tv_sec == 0 && duration.tv_nsec == 0) duration.tv_nsec = 1;
+
+	bluObjInstance* loop = AS_INSTANCE(args[0]);
+	args[0] = NIL_VAL;
+
+	if (vm->fiber == NULL) {
+		while (nanosleep(&duration, &duration) == -1) {
+			if (errno != EINTR) return -1;
+		}
+
+		return 1;
+	}
+
+	int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timer == -1) return -1;
+
+	struct itimerspec spec = {.it_value = duration};
+	if (timerfd_settime(timer, 0, &spec, NULL) == -1 || !suspendOn(vm, loop, timer, EPOLLIN, true)) {
+		close(timer);
+		return -1;
+	}
+
+	return 1;
+}
+
+int8_t Loop_poll(bluVM* vm, int8_t argCount, bluValue* args) {
+	bluObjInstance* instance = AS_INSTANCE(args[0]);
+	LoopData* loop = instance->data;
+
+	if (loop->pending == 0) {
+		args[0] = OBJ_VAL(bluNewArray(vm, 0));
+		return 1;
+	}
+
+	struct epoll_event events[EVENT_BATCH];
+
+	int count;
+	while ((count = epoll_wait(loop->epoll, events, EVENT_BATCH, -1)) == -1) {
+		if (errno != EINTR) return -1;
+	}
+
+	IntBuffer woken;
+	IntBufferInit(&woken);
+
+	for (int32_t i = 0; i < count; i++) {
+		int fd = events[i].data.fd;
+		bluRegistration* registration = &loop->registrations.data[fd];
+
+		// Errors and hang ups wake the fibers of both directions, their next read or write reports them.
+		uint32_t ready = events[i].events;
+		if (ready & (EPOLLIN | EPOLLERR | EPOLLHUP)) takeWaits(loop, &registration->readers, &woken);
+		if (ready & (EPOLLOUT | EPOLLERR | EPOLLHUP)) takeWaits(loop, &registration->writers, &woken);
+
+		if (registration->isTimer) {
+			close(fd);
+			*registration = (bluRegistration){.events = 0, .readers = -1, .writers = -1, .isTimer = false};
+		} else if (!updateRegistration(loop, fd, registration)) {
+			// The fibers still waiting retry their reads and writes, and wait again.
+			takeWaits(loop, &registration->readers, &woken);
+			takeWaits(loop, &registration->writers, &woken);
+			updateRegistration(loop, fd, registration);
+		}
+	}
+
+	args[0] = OBJ_VAL(wakeFibers(vm, instance, &woken));
+
+	IntBufferFree(&woken);
+
+	return 1;
+}
+
+// Forgets the waits for [fd], which is about to be closed, and returns their fibers to be resumed.
+int8_t Loop_cancel(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_NUMBER(args[1])) return -1;
+
+	int fd = AS_NUMBER(args[1]);
+
+	bluObjInstance* instance = AS_INSTANCE(args[0]);
+	LoopData* loop = instance->data;
+
+	IntBuffer woken;
+	IntBufferInit(&woken);
+
+	if (fd >= 0 && fd < loop->registrations.count && !loop->registrations.data[fd].isTimer) {
+		bluRegistration* registration = &loop->registrations.data[fd];
+
+		takeWaits(loop, &registration->readers, &woken);
+		takeWaits(loop, &registration->writers, &woken);
+		updateRegistration(loop, fd, registration);
+	}
+
+	args[0] = OBJ_VAL(wakeFibers(vm, instance, &woken));
+
+	IntBufferFree(&woken);
+
+	return 1;
+}
+
+int8_t Loop_pending(bluVM* vm, int8_t argCount, bluValue* args) {
+	args[0] = NUMBER_VAL(((LoopData*)AS_INSTANCE(args[0])->data)->pending);
+
+	return 1;
+}
+
+// Addresses are numeric IPv4 or IPv6 ones, resolving names would block. Without a port, the address is the path of a
+// Unix socket.
+static bool socketAddress(bluValue address, bluValue port, struct sockaddr_storage* storage, socklen_t* length) {
+	if (!IS_STRING(address)) return false;
+
+	memset(storage, 0, sizeof(struct sockaddr_storage));
+
+	if (IS_NIL(port)) {
+		struct sockaddr_un* local = (struct sockaddr_un*)storage;
+		if (AS_STRING(address)->length >= (int32_t)sizeof(local->sun_path)) return false;
+
+		local->sun_family = AF_UNIX;
+		strcpy(local->sun_path, AS_CSTRING(address));
+
+		*length = sizeof(struct sockaddr_un);
+		return true;
+	}
+
+	if (!IS_NUMBER(port)) return false;
+
+	struct sockaddr_in* ipv4 = (struct sockaddr_in*)storage;
+	if (inet_pton(AF_INET, AS_CSTRING(address), &ipv4->sin_addr) == 1) {
+		ipv4->sin_family = AF_INET;
+		ipv4->sin_port = htons((uint16_t)AS_NUMBER(port));
+
+		*length = sizeof(struct sockaddr_in);
+		return true;
+	}
+
+	struct sockaddr_in6* ipv6 = (struct sockaddr_in6*)storage;
+	if (inet_pton(AF_INET6, AS_CSTRING(address), &ipv6->sin6_addr) == 1) {
+		ipv6->sin6_family = AF_INET6;
+		ipv6->sin6_port = htons((uint16_t)AS_NUMBER(port));
+
+		*length = sizeof(struct sockaddr_in6);
+		return true;
+	}
+
+	return false;
+}
+
+int8_t Stream__listen(bluVM* vm, int8_t argCount, bluValue* args) {
+	struct sockaddr_storage address;
+	socklen_t length;
+
+	if (!socketAddress(args[1], argCount > 1 ? args[2] : NIL_VAL, &address, &length)) return -1;
+
+	int fd = socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd == -1) return -1;
+
+	if (address.ss_family == AF_UNIX) {
+		// A socket left behind by an earlier server would make the bind fail. Other files are kept.
+		struct stat info;
+		if (stat(AS_CSTRING(args[1]), &info) == 0 && S_ISSOCK(info.st_mode)) unlink(AS_CSTRING(args[1]));
+	} else {
+		int reuse = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int));
+	}
+
+	if (bind(fd, (struct sockaddr*)&address, length) == -1 || listen(fd, SOMAXCONN) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	bluObjInstance* stream = newStream(vm, fd);
+	if (address.ss_family == AF_UNIX) ((StreamData*)stream->data)->path = strdup(AS_CSTRING(args[1]));
+
+	args[0] = OBJ_VAL(stream);
+
+	return 1;
+}
+
+// Starts connecting, Stream.connect() waits for the stream to become writable and checks the outcome.
+int8_t Stream__connect(bluVM* vm, int8_t argCount, bluValue* args) {
+	struct sockaddr_storage address;
+	socklen_t length;
+
+	if (!socketAddress(args[1], argCount > 1 ? args[2] : NIL_VAL, &address, &length)) return -1;
+
+	int fd = socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd == -1) return -1;
+
+	if (connect(fd, (struct sockaddr*)&address, length) == -1 && errno != EINPROGRESS) {
+		close(fd);
+		return -1;
+	}
+
+	args[0] = OBJ_VAL(newStream(vm, fd));
+
+	return 1;
+}
+
+int8_t Stream__pipe(bluVM* vm, int8_t argCount, bluValue* args) {
+	int fds[2];
+	if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1) return -1;
+
+	bluObjArray* ends = bluNewArray(vm, 2);
+	ends->data[0] = OBJ_VAL(newStream(vm, fds[0]));
+	ends->data[1] = OBJ_VAL(newStream(vm, fds[1]));
+
+	args[0] = OBJ_VAL(ends);
+
+	return 1;
+}
+
+int8_t Stream_connected(bluVM* vm, int8_t argCount, bluValue* args) {
+	int error = 0;
+	socklen_t length = sizeof(int);
+
+	if (getsockopt(streamFd(args[0]), SOL_SOCKET, SO_ERROR, &error, &length) == -1 || error != 0) return -1;
+
+	return 1;
+}
+
+// Accepts a connection. Returns false when accepting would block and nil once the stream is closed.
+int8_t Stream_accept(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (streamFd(args[0]) == -1) {
+		args[0] = NIL_VAL;
+		return 1;
+	}
+
+	int fd = accept4(streamFd(args[0]), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+	if (fd == -1) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+
+		args[0] = BOOL_VAL(false);
+		return 1;
+	}
+
+	args[0] = OBJ_VAL(newStream(vm, fd));
+
+	return 1;
+}
+
+// Reads up to [size] bytes. Returns nil at the end of the stream, also once it's closed, and false when reading would
+// block.
+int8_t Stream_read(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 1) return -1;
+
+	if (streamFd(args[0]) == -1) {
+		args[0] = NIL_VAL;
+		return 1;
+	}
+
+	size_t size = AS_NUMBER(args[1]);
+	char* buffer = malloc(size);
+
+	ssize_t count;
+	while ((count = read(streamFd(args[0]), buffer, size)) == -1 && errno == EINTR) {
+	}
+
+	if (count > 0) {
+		args[0] = OBJ_VAL(bluCopyString(vm, buffer, count));
+	} else if (count == 0) {
+		args[0] = NIL_VAL;
+	} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		args[0] = BOOL_VAL(false);
+	}
+
+	free(buffer);
+
+	return count == -1 && errno != EAGAIN && errno != EWOULDBLOCK ? -1 : 1;
+}
+
+// Writes [data] from [offset] on. Returns the number of bytes written, or false when writing would block.
+int8_t Stream_write(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_STRING(args[1]) || !IS_NUMBER(args[2])) return -1;
+
+	bluObjString* data = AS_STRING(args[1]);
+	int32_t offset = AS_NUMBER(args[2]);
+	if (offset < 0 || offset > data->length) return -1;
+
+	int fd = streamFd(args[0]);
+
+	// Sockets are written with send() so a peer that went away is an error instead of a SIGPIPE.
+	ssize_t count;
+	while ((count = send(fd, data->chars + offset, data->length - offset, MSG_NOSIGNAL)) == -1 && errno == EINTR) {
+	}
+
+	if (count == -1 && errno == ENOTSOCK) {
+		while ((count = write(fd, data->chars + offset, data->length - offset)) == -1 && errno == EINTR) {
+		}
+	}
+
+	if (count == -1) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+
+		args[0] = BOOL_VAL(false);
+		return 1;
+	}
+
+	args[0] = NUMBER_VAL(count);
+
+	return 1;
+}
+
+int8_t Stream_fd(bluVM* vm, int8_t argCount, bluValue* args) {
+	args[0] = NUMBER_VAL(streamFd(args[0]));
+
+	return 1;
+}
+
+// Local port of a TCP socket, for servers listening on port 0. Nil for other streams.
+int8_t Stream_port(bluVM* vm, int8_t argCount, bluValue* args) {
+	struct sockaddr_storage address;
+	socklen_t length = sizeof(struct sockaddr_storage);
+
+	if (getsockname(streamFd(args[0]), (struct sockaddr*)&address, &length) == -1) {
+		args[0] = NIL_VAL;
+	} else if (address.ss_family == AF_INET) {
+		args[0] = NUMBER_VAL(ntohs(((struct sockaddr_in*)&address)->sin_port));
+	} else if (address.ss_family == AF_INET6) {
+		args[0] = NUMBER_VAL(ntohs(((struct sockaddr_in6*)&address)->sin6_port));
+	} else {
+		args[0] = NIL_VAL;
+	}
+
+	return 1;
+}
+
+int8_t Stream_close(bluVM* vm, int8_t argCount, bluValue* args) {
+	StreamData* stream = AS_INSTANCE(args[0])->data;
+	if (stream != NULL) closeStream(stream);
+
+	return 1;
+}
+
+void bluInitEvent(bluVM* vm) {
+	bluInterpret(vm, eventSource, "__EVENT__");
+
+	bluObj* loopClass = bluGetGlobal(vm, "Loop");
+
+	AS_CLASS(OBJ_VAL(loopClass))->construct = constructLoop;
+	AS_CLASS(OBJ_VAL(loopClass))->destruct = destructLoop;
+
+	bluDefineMethod(vm, loopClass, "wait", Loop_wait, 1);
+	bluDefineMethod(vm, loopClass, "sleep", Loop_sleep, 1);
+	bluDefineMethod(vm, loopClass, "poll", Loop_poll, 0);
+	bluDefineMethod(vm, loopClass, "_cancel", Loop_cancel, 1);
+	bluDefineMethod(vm, loopClass, "pending", Loop_pending, 0);
+
+	bluObj* streamClass = bluGetGlobal(vm, "Stream");
+
+	AS_CLASS(OBJ_VAL(streamClass))->destruct = destructStream;
+
+	bluDefineStaticMethod(vm, streamClass, "listen", Stream__listen, 1);
+	bluDefineStaticMethod(vm, streamClass, "_connect", Stream__connect, 1);
+	bluDefineStaticMethod(vm, streamClass, "pipe", Stream__pipe, 0);
+	bluDefineMethod(vm, streamClass, "_connected", Stream_connected, 0);
+	bluDefineMethod(vm, streamClass, "_accept", Stream_accept, 0);
+	bluDefineMethod(vm, streamClass, "_read", Stream_read, 1);
+	bluDefineMethod(vm, streamClass, "_write", Stream_write, 2);
+	bluDefineMethod(vm, streamClass, "fd", Stream_fd, 0);
+	bluDefineMethod(vm, streamClass, "port", Stream_port, 0);
+	bluDefineMethod(vm, streamClass, "_close", Stream_close, 0);
+
+	// The default loop needs the natives of Loop, so it's made once they are defined.
+	bluInterpret(vm, "Event.loop = Loop()", "__EVENT__");
+}
@@ -0,0 +1,8 @@
+#ifndef blu_event_h
+#define blu_event_h
+
+#include "include/blu.h"
+
+void bluInitEvent(bluVM* vm);
+
+#endif
@@ -1,25 +1,59 @@
 #include "file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "util/format.h"
 #include "vm/memory.h"
 #include "vm/object.h"
 #include "vm/value.h"
+#include "vm/vm.h"
 
 #include "file.blu.inc"
 
+// Chunk size for copying between descriptors and reading streams of unknown size.
+#define FILE_CHUNK (1 << 20)
+
 typedef struct {
 	FILE* fd;
+
+	// Buffer given to stdio by setBuffer(), owned by the file.
+	char* buffer;
+	size_t bufferSize;
 } FileData;
 
-void construct(bluVM* vm, bluObjInstance* instance) {
+static void construct(bluVM* vm, bluObjInstance* instance) {
 	instance->data = bluAllocate(vm, sizeof(FileData));
 	((FileData*)instance->data)->fd = NULL;
+	((FileData*)instance->data)->buffer = NULL;
+	((FileData*)instance->data)->bufferSize = 0;
+}
+
+static void closeFile(bluVM* vm, FileData* file) {
+	if (file->fd != NULL) fclose(file->fd);
+	file->fd = NULL;
+
+	if (file->buffer != NULL) bluDeallocate(vm, file->buffer, file->bufferSize);
+	file->buffer = NULL;
+	file->bufferSize = 0;
 }
 
-void destruct(bluVM* vm, bluObjInstance* instance) {
-	fclose(((FileData*)instance->data)->fd);
+static void destruct(bluVM* vm, bluObjInstance* instance) {
+	closeFile(vm, instance->data);
 
 	bluDeallocate(vm, instance->data, sizeof(FileData));
 }
 
+static FILE* openedFile(bluValue receiver) {
+	return ((FileData*)AS_INSTANCE(receiver)->data)->fd;
+}
+
 int8_t File_open(bluVM* vm, int8_t argCount, bluValue* args) {
 	bluValue value;
 	bluObjInstance* receiver = AS_INSTANCE(args[0]);
@@ -41,7 +75,7 @@ int8_t File_open(bluVM* vm, int8_t argCount, bluValue* args) {
 int8_t File_close(bluVM* vm, int8_t argCount, bluValue* args) {
 	bluObjInstance* receiver = AS_INSTANCE(args[0]);
 
-	fclose(((FileData*)receiver->data)->fd);
+	closeFile(vm, receiver->data);
 
 	return 1;
 }
@@ -80,6 +114,659 @@ int8_t File_readLine(bluVM* vm, int8_t argCount, bluValue* args) {
 	return 1;
 }
 
+// Replaces the stdio buffer of the file with one of [size] bytes. Has to be called before the file is read or written.
+int8_t File_setBuffer(bluVM* vm, int8_t argCount, bluValue* args) {
+	FileData* file = AS_INSTANCE(args[0])->data;
+
+	if (file->fd == NULL || !IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 1) return -1;
+
+	size_t size = AS_NUMBER(args[1]);
+	char* buffer = bluAllocate(vm, size);
+
+	if (setvbuf(file->fd, buffer, _IOFBF, size) != 0) {
+		bluDeallocate(vm, buffer, size);
+		return -1;
+	}
+
+	if (file->buffer != NULL) bluDeallocate(vm, file->buffer, file->bufferSize);
+
+	file->buffer = buffer;
+	file->bufferSize = size;
+
+	return 1;
+}
+
+// Reads up to [count] bytes. Returns nil at the end of the file.
+int8_t File_read(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+
+	if (file == NULL || !IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 0 || AS_NUMBER(args[1]) > INT32_MAX) return -1;
+
+	int32_t count = AS_NUMBER(args[1]);
+
+	bluObjString* string = bluNewString(vm, count);
+	size_t read = fread(string->chars, sizeof(char), count, file);
+
+	if (ferror(file)) return -1;
+
+	if (read == 0 && count > 0) {
+		args[0] = NIL_VAL;
+	} else if ((int32_t)read == count) {
+		string->chars[count] = '\0';
+		args[0] = OBJ_VAL(bluTakeString(vm, string));
+	} else {
+		// The unused string is left to the GC.
+		args[0] = OBJ_VAL(bluCopyString(vm, string->chars, read));
+	}
+
+	return 1;
+}
+
+// Reads the rest of the file into one string. Regular files are read straight into a string of the right size.
+int8_t File_readAll(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+	if (file == NULL) return -1;
+
+	struct stat info;
+	long position = ftell(file);
+
+	if (fstat(fileno(file), &info) == 0 && S_ISREG(info.st_mode) && position >= 0 && info.st_size >= position) {
+		// Strings hold at most INT32_MAX bytes, longer contents fail rather than come back cut short.
+		if (info.st_size - position > INT32_MAX) return -1;
+
+		int32_t count = info.st_size - position;
+
+		bluObjString* string = bluNewString(vm, count);
+		size_t read = fread(string->chars, sizeof(char), count, file);
+
+		if (ferror(file)) return -1;
+
+		if ((int32_t)read == count) {
+			string->chars[count] = '\0';
+			args[0] = OBJ_VAL(bluTakeString(vm, string));
+		} else {
+			args[0] = OBJ_VAL(bluCopyString(vm, string->chars, read));
+		}
+
+		return 1;
+	}
+
+	ByteBuffer buffer;
+	ByteBufferInit(&buffer);
+
+	size_t read;
+	do {
+		ByteBufferFill(&buffer, 0, FILE_CHUNK);
+		buffer.count -= FILE_CHUNK;
+
+		read = fread(buffer.data + buffer.count, sizeof(char), FILE_CHUNK, file);
+		buffer.count += read;
+	} while (read == FILE_CHUNK && buffer.count <= INT32_MAX - FILE_CHUNK);
+
+	// A full last chunk means the loop stopped at the limit, unless the stream happens to end right there.
+	if (ferror(file) || (read == FILE_CHUNK && getc(file) != EOF)) {
+		ByteBufferFree(&buffer);
+		return -1;
+	}
+
+	args[0] = OBJ_VAL(bluCopyString(vm, (const char*)buffer.data, buffer.count));
+	ByteBufferFree(&buffer);
+
+	return 1;
+}
+
+int8_t File_write(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+	if (file == NULL || !IS_STRING(args[1])) return -1;
+
+	bluObjString* string = AS_STRING(args[1]);
+	if (fwrite(string->chars, sizeof(char), string->length, file) != (size_t)string->length) return -1;
+
+	return 1;
+}
+
+// Writes all strings of [array] with as few system calls as possible, at the current position.
+int8_t File_writeAll(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+	if (file == NULL || !IS_ARRAY(args[1])) return -1;
+
+	bluObjArray* array = AS_ARRAY(args[1]);
+	for (int32_t i = 0; i < array->len; i++) {
+		if (!IS_STRING(array->data[i])) return -1;
+	}
+
+	// Whatever stdio buffered has to go first.
+	if (fflush(file) != 0) return -1;
+
+	int fd = fileno(file);
+	struct iovec vectors[IOV_MAX];
+
+	int32_t next = 0;
+	size_t skip = 0;
+
+	while (next < array->len) {
+		int32_t count = 0;
+
+		for (int32_t i = next; i < array->len && count < IOV_MAX; i++) {
+			bluObjString* string = AS_STRING(array->data[i]);
+			size_t offset = i == next ? skip : 0;
+
+			vectors[count].iov_base = string->chars + offset;
+			vectors[count].iov_len = string->length - offset;
+			count++;
+		}
+
+		ssize_t written = writev(fd, vectors, count);
+		if (written == -1) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+
+		// Skip over what was written, which may end in the middle of a string.
+		size_t left = written;
+		while (next < array->len && left >= AS_STRING(array->data[next])->length - skip) {
+			left -= AS_STRING(array->data[next])->length - skip;
+			skip = 0;
+			next++;
+		}
+
+		skip += left;
+	}
+
+	return 1;
+}
+
+// Reads up to [count] bytes at [offset] without moving the position of the file.
+int8_t File_readAt(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+
+	if (file == NULL || !IS_NUMBER(args[1]) || !IS_NUMBER(args[2])) return -1;
+	if (AS_NUMBER(args[1]) < 0 || AS_NUMBER(args[2]) < 0 || AS_NUMBER(args[2]) > INT32_MAX) return -1;
+
+	off_t offset = AS_NUMBER(args[1]);
+	int32_t count = AS_NUMBER(args[2]);
+
+	if (fflush(file) != 0) return -1;
+
+	char* buffer = malloc(count > 0 ? count : 1);
+
+	ssize_t read;
+	while ((read = pread(fileno(file), buffer, count, offset)) == -1 && errno == EINTR) {
+	}
+
+	if (read > 0 || (read == 0 && count == 0)) {
+		args[0] = OBJ_VAL(bluCopyString(vm, buffer, read));
+	} else {
+		args[0] = NIL_VAL;
+	}
+
+	free(buffer);
+
+	return read == -1 ? -1 : 1;
+}
+
+// Writes [data] at [offset] without moving the position of the file.
+int8_t File_writeAt(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+
+	if (file == NULL || !IS_NUMBER(args[1]) || !IS_STRING(args[2]) || AS_NUMBER(args[1]) < 0) return -1;
+
+	off_t offset = AS_NUMBER(args[1]);
+	bluObjString* string = AS_STRING(args[2]);
+
+	if (fflush(file) != 0) return -1;
+
+	int32_t done = 0;
+	while (done < string->length) {
+		ssize_t written = pwrite(fileno(file), string->chars + done, string->length - done, offset + done);
+
+		if (written == -1) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+
+		done += written;
+	}
+
+	return 1;
+}
+
+int8_t File_seek(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+	if (file == NULL || !IS_NUMBER(args[1])) return -1;
+
+	if (fseeko(file, (off_t)AS_NUMBER(args[1]), SEEK_SET) != 0) return -1;
+
+	return 1;
+}
+
+int8_t File_tell(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+	if (file == NULL) return -1;
+
+	args[0] = NUMBER_VAL(ftello(file));
+
+	return 1;
+}
+
+int8_t File_size(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+	if (file == NULL) return -1;
+
+	struct stat info;
+	if (fflush(file) != 0 || fstat(fileno(file), &info) != 0) return -1;
+
+	args[0] = NUMBER_VAL(info.st_size);
+
+	return 1;
+}
+
+int8_t File_flush(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+	if (file == NULL || fflush(file) != 0) return -1;
+
+	return 1;
+}
+
+// Copies a chunk through user space, for files the kernel can't copy between. Returns the number of bytes copied.
+static ssize_t copyChunk(int in, int out, off_t* offset, size_t size, char* buffer) {
+	ssize_t read = pread(in, buffer, size, *offset);
+	if (read <= 0) return read;
+
+	for (ssize_t done = 0; done < read;) {
+		ssize_t written = write(out, buffer + done, read - done);
+
+		if (written == -1 && errno != EINTR) return -1;
+		if (written > 0) done += written;
+	}
+
+	*offset += read;
+	return read;
+}
+
+// Copies the first [count] bytes of [in] to [out] within the kernel when possible. Falls back from copy_file_range to
+// sendfile to plain reads and writes, as the kinds of the files allow.
+static bool copyRange(int in, int out, off_t count) {
+	off_t offset = 0;
+
+	bool copyFileRange = true;
+	bool sendFile = true;
+	bool failed = false;
+	char* buffer = NULL;
+
+	while (count > 0 && !failed) {
+		size_t chunk = count < FILE_CHUNK ? count : FILE_CHUNK;
+		ssize_t copied;
+
+		if (copyFileRange) {
+			copied = copy_file_range(in, &offset, out, NULL, chunk, 0);
+			if (copied == -1 && errno != EINTR) copyFileRange = false;
+		} else if (sendFile) {
+			copied = sendfile(out, in, &offset, chunk);
+			if (copied == -1 && errno != EINTR) sendFile = false;
+		} else {
+			if (buffer == NULL) buffer = malloc(FILE_CHUNK);
+
+			copied = copyChunk(in, out, &offset, chunk, buffer);
+			if (copied == -1 && errno != EINTR) failed = true;
+		}
+
+		// The file got shorter while it was copied.
+		if (copied == 0) break;
+		if (copied > 0) count -= copied;
+	}
+
+	free(buffer);
+
+	return !failed;
+}
+
+// Copies the whole file to [target], a path or another open file, at its position. A file at the path is replaced.
+// Returns the number of bytes copied.
+int8_t File_copyTo(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* file = openedFile(args[0]);
+	if (file == NULL) return -1;
+
+	struct stat info;
+	if (fflush(file) != 0 || fstat(fileno(file), &info) != 0) return -1;
+
+	int out;
+	if (IS_STRING(args[1])) {
+		out = open(AS_CSTRING(args[1]), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	} else if (IS_INSTANCE(args[1]) && AS_INSTANCE(args[1])->obj.class == AS_INSTANCE(args[0])->obj.class) {
+		FILE* target = openedFile(args[1]);
+		out = target != NULL && fflush(target) == 0 ? fileno(target) : -1;
+	} else {
+		return -1;
+	}
+
+	if (out == -1) return -1;
+
+	bool copied = copyRange(fileno(file), out, info.st_size);
+	if (IS_STRING(args[1])) close(out);
+
+	if (!copied) return -1;
+
+	args[0] = NUMBER_VAL(info.st_size);
+
+	return 1;
+}
+
+// Opens a new temporary file for reading and writing, removed once it's closed.
+int8_t File__temp(bluVM* vm, int8_t argCount, bluValue* args) {
+	FILE* fd = tmpfile();
+	if (fd == NULL) return -1;
+
+	bluObjInstance* file = bluNewInstance(vm, AS_CLASS(args[0]));
+	construct(vm, file);
+
+	((FileData*)file->data)->fd = fd;
+
+	args[0] = OBJ_VAL(file);
+
+	return 1;
+}
+
+// Removes the file [name]. Returns false when it couldn't be removed.
+int8_t File__remove(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_STRING(args[1])) return -1;
+
+	args[0] = BOOL_VAL(unlink(AS_CSTRING(args[1])) == 0);
+
+	return 1;
+}
+
+// A read-only mapping of a whole file. Views and line iterators point into it, so it's unmapped only once the last of
+// them is gone.
+typedef struct {
+	char* chars;
+	size_t size;
+	int32_t references;
+} MappingData;
+
+// Every instance of Mapping, View and Lines starts with the mapping it references.
+typedef struct {
+	MappingData* mapping;
+} MappedData;
+
+typedef struct {
+	MappingData* mapping;
+	const char* chars;
+	int32_t length;
+} ViewData;
+
+typedef struct {
+	MappingData* mapping;
+	size_t offset;
+} LinesData;
+
+static void releaseMapping(bluVM* vm, MappingData* mapping) {
+	if (--mapping->references > 0) return;
+
+	if (mapping->chars != NULL) munmap(mapping->chars, mapping->size);
+
+	bluDeallocate(vm, mapping, sizeof(MappingData));
+}
+
+static void destructMapping(bluVM* vm, bluObjInstance* instance) {
+	if (instance->data == NULL) return;
+
+	releaseMapping(vm, ((MappedData*)instance->data)->mapping);
+	bluDeallocate(vm, instance->data, sizeof(MappedData));
+}
+
+static void destructView(bluVM* vm, bluObjInstance* instance) {
+	if (instance->data == NULL) return;
+
+	releaseMapping(vm, ((ViewData*)instance->data)->mapping);
+	bluDeallocate(vm, instance->data, sizeof(ViewData));
+}
+
+static void destructLines(bluVM* vm, bluObjInstance* instance) {
+	if (instance->data == NULL) return;
+
+	releaseMapping(vm, ((LinesData*)instance->data)->mapping);
+	bluDeallocate(vm, instance->data, sizeof(LinesData));
+}
+
+static bluValue newView(bluVM* vm, MappingData* mapping, const char* chars, int32_t length) {
+	bluObjInstance* instance = bluNewInstance(vm, vm->viewClass);
+
+	ViewData* view = bluAllocate(vm, sizeof(ViewData));
+	view->mapping = mapping;
+	view->chars = chars;
+	view->length = length;
+
+	mapping->references++;
+	instance->data = view;
+
+	return OBJ_VAL(instance);
+}
+
+// Bytes of a string or a view.
+static bool viewBytes(bluVM* vm, bluValue value, const char** chars, int32_t* length) {
+	if (IS_STRING(value)) {
+		*chars = AS_STRING(value)->chars;
+		*length = AS_STRING(value)->length;
+		return true;
+	}
+
+	if (!IS_INSTANCE(value) || AS_INSTANCE(value)->obj.class != vm->viewClass) return false;
+	if (AS_INSTANCE(value)->data == NULL) return false;
+
+	*chars = ((ViewData*)AS_INSTANCE(value)->data)->chars;
+	*length = ((ViewData*)AS_INSTANCE(value)->data)->length;
+	return true;
+}
+
+int8_t File__mmap(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_STRING(args[1])) return -1;
+
+	int fd = open(AS_CSTRING(args[1]), O_RDONLY | O_CLOEXEC);
+	if (fd == -1) return -1;
+
+	struct stat info;
+	if (fstat(fd, &info) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	MappingData* mapping = bluAllocate(vm, sizeof(MappingData));
+	mapping->chars = NULL;
+	mapping->size = info.st_size;
+	mapping->references = 1;
+
+	// Empty files can't be mapped, they are left without any bytes.
+	if (mapping->size > 0) {
+		mapping->chars = mmap(NULL, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (mapping->chars == MAP_FAILED) {
+			close(fd);
+			bluDeallocate(vm, mapping, sizeof(MappingData));
+			return -1;
+		}
+
+		madvise(mapping->chars, mapping->size, MADV_SEQUENTIAL);
+	}
+
+	// The mapping stays valid without the descriptor.
+	close(fd);
+
+	bluObjInstance* instance = bluNewInstance(vm, vm->mappingClass);
+	instance->data = bluAllocate(vm, sizeof(MappedData));
+	((MappedData*)instance->data)->mapping = mapping;
+
+	args[0] = OBJ_VAL(instance);
+
+	return 1;
+}
+
+// Returns the mapping of [receiver], or NULL for instances made by scripts, which have none.
+static MappingData* receiverMapping(bluValue receiver) {
+	MappedData* mapped = AS_INSTANCE(receiver)->data;
+
+	return mapped != NULL ? mapped->mapping : NULL;
+}
+
+int8_t Mapping_len(bluVM* vm, int8_t argCount, bluValue* args) {
+	MappingData* mapping = receiverMapping(args[0]);
+	if (mapping == NULL) return -1;
+
+	args[0] = NUMBER_VAL(mapping->size);
+
+	return 1;
+}
+
+int8_t Mapping_slice(bluVM* vm, int8_t argCount, bluValue* args) {
+	MappingData* mapping = receiverMapping(args[0]);
+	if (mapping == NULL) return -1;
+
+	if (!IS_NUMBER(args[1]) || !IS_NUMBER(args[2])) return -1;
+
+	double from = AS_NUMBER(args[1]);
+	double length = AS_NUMBER(args[2]);
+	if (from < 0 || length < 0 || length > INT32_MAX || from + length > mapping->size) return -1;
+
+	args[0] = newView(vm, mapping, mapping->chars + (size_t)from, (int32_t)length);
+
+	return 1;
+}
+
+int8_t Mapping_lines(bluVM* vm, int8_t argCount, bluValue* args) {
+	MappingData* mapping = receiverMapping(args[0]);
+	if (mapping == NULL) return -1;
+
+	bluObjInstance* instance = bluNewInstance(vm, vm->linesClass);
+
+	LinesData* lines = bluAllocate(vm, sizeof(LinesData));
+	lines->mapping = mapping;
+	lines->offset = 0;
+
+	mapping->references++;
+	instance->data = lines;
+
+	args[0] = OBJ_VAL(instance);
+
+	return 1;
+}
+
+// Returns a view of the next line without its newline, or nil after the last one.
+int8_t Lines_next(bluVM* vm, int8_t argCount, bluValue* args) {
+	LinesData* lines = AS_INSTANCE(args[0])->data;
+	if (lines == NULL) return -1;
+
+	MappingData* mapping = lines->mapping;
+
+	if (lines->offset >= mapping->size) {
+		args[0] = NIL_VAL;
+		return 1;
+	}
+
+	const char* start = mapping->chars + lines->offset;
+	size_t left = mapping->size - lines->offset;
+
+	const char* end = memchr(start, '\n', left);
+	size_t length = end != NULL ? (size_t)(end - start) : left;
+	if (length > INT32_MAX) return -1;
+
+	lines->offset += length + (end != NULL ? 1 : 0);
+
+	args[0] = newView(vm, mapping, start, (int32_t)length);
+
+	return 1;
+}
+
+int8_t View_len(bluVM* vm, int8_t argCount, bluValue* args) {
+	ViewData* view = AS_INSTANCE(args[0])->data;
+	if (view == NULL) return -1;
+
+	args[0] = NUMBER_VAL(view->length);
+
+	return 1;
+}
+
+int8_t View_toString(bluVM* vm, int8_t argCount, bluValue* args) {
+	ViewData* view = AS_INSTANCE(args[0])->data;
+	if (view == NULL) return -1;
+
+	args[0] = OBJ_VAL(bluCopyString(vm, view->chars, view->length));
+
+	return 1;
+}
+
+int8_t View_slice(bluVM* vm, int8_t argCount, bluValue* args) {
+	ViewData* view = AS_INSTANCE(args[0])->data;
+	if (view == NULL) return -1;
+
+	if (!IS_NUMBER(args[1]) || !IS_NUMBER(args[2])) return -1;
+
+	double from = AS_NUMBER(args[1]);
+	double length = AS_NUMBER(args[2]);
+	if (from < 0 || length < 0 || from + length > view->length) return -1;
+
+	args[0] = newView(vm, view->mapping, view->chars + (int32_t)from, (int32_t)length);
+
+	return 1;
+}
+
+int8_t View_equals(bluVM* vm, int8_t argCount, bluValue* args) {
+	ViewData* view = AS_INSTANCE(args[0])->data;
+	if (view == NULL) return -1;
+
+	const char* chars;
+	int32_t length;
+
+	bool equal = viewBytes(vm, args[1], &chars, &length) && length == view->length &&
+	             memcmp(chars, view->chars, length) == 0;
+
+	args[0] = BOOL_VAL(equal);
+
+	return 1;
+}
+
+int8_t View_startsWith(bluVM* vm, int8_t argCount, bluValue* args) {
+	ViewData* view = AS_INSTANCE(args[0])->data;
+	if (view == NULL) return -1;
+
+	const char* chars;
+	int32_t length;
+	if (!viewBytes(vm, args[1], &chars, &length)) return -1;
+
+	args[0] = BOOL_VAL(length <= view->length && memcmp(chars, view->chars, length) == 0);
+
+	return 1;
+}
+
+// Offset of the first occurrence of [string] in the view, or -1.
+int8_t View_find(bluVM* vm, int8_t argCount, bluValue* args) {
+	ViewData* view = AS_INSTANCE(args[0])->data;
+	if (view == NULL) return -1;
+
+	const char* chars;
+	int32_t length;
+	if (!viewBytes(vm, args[1], &chars, &length)) return -1;
+
+	const char* found = memmem(view->chars, view->length, chars, length);
+
+	args[0] = NUMBER_VAL(found != NULL ? found - view->chars : -1);
+
+	return 1;
+}
+
+int8_t View_toNumber(bluVM* vm, int8_t argCount, bluValue* args) {
+	ViewData* view = AS_INSTANCE(args[0])->data;
+	if (view == NULL) return -1;
+
+	double number;
+	if (bluParseNumber(view->chars, view->length, &number)) {
+		args[0] = NUMBER_VAL(number);
+	} else {
+		args[0] = NIL_VAL;
+	}
+
+	return 1;
+}
+
 void bluInitFile(bluVM* vm) {
 	bluInterpret(vm, fileSource, "__FILE__");
 
@@ -92,4 +779,48 @@ void bluInitFile(bluVM* vm) {
 	bluDefineMethod(vm, fileClass, "close", File_close, 0);
 	bluDefineMethod(vm, fileClass, "rewind", File_rewind, 0);
 	bluDefineMethod(vm, fileClass, "readLine", File_readLine, 0);
+	bluDefineMethod(vm, fileClass, "setBuffer", File_setBuffer, 1);
+	bluDefineMethod(vm, fileClass, "read", File_read, 1);
+	bluDefineMethod(vm, fileClass, "readAll", File_readAll, 0);
+	bluDefineMethod(vm, fileClass, "write", File_write, 1);
+	bluDefineMethod(vm, fileClass, "writeAll", File_writeAll, 1);
+	bluDefineMethod(vm, fileClass, "readAt", File_readAt, 2);
+	bluDefineMethod(vm, fileClass, "writeAt", File_writeAt, 2);
+	bluDefineMethod(vm, fileClass, "seek", File_seek, 1);
+	bluDefineMethod(vm, fileClass, "tell", File_tell, 0);
+	bluDefineMethod(vm, fileClass, "size", File_size, 0);
+	bluDefineMethod(vm, fileClass, "flush", File_flush, 0);
+	bluDefineMethod(vm, fileClass, "copyTo", File_copyTo, 1);
+	bluDefineStaticMethod(vm, fileClass, "temp", File__temp, 0);
+	bluDefineStaticMethod(vm, fileClass, "mmap", File__mmap, 1);
+	bluDefineStaticMethod(vm, fileClass, "remove", File__remove, 1);
+
+	bluObj* mappingClass = bluGetGlobal(vm, "Mapping");
+	vm->mappingClass = (bluObjClass*)mappingClass;
+
+	AS_CLASS(OBJ_VAL(mappingClass))->destruct = destructMapping;
+
+	bluDefineMethod(vm, mappingClass, "len", Mapping_len, 0);
+	bluDefineMethod(vm, mappingClass, "slice", Mapping_slice, 2);
+	bluDefineMethod(vm, mappingClass, "lines", Mapping_lines, 0);
+
+	bluObj* linesClass = bluGetGlobal(vm, "Lines");
+	vm->linesClass = (bluObjClass*)linesClass;
+
+	AS_CLASS(OBJ_VAL(linesClass))->destruct = destructLines;
+
+	bluDefineMethod(vm, linesClass, "next", Lines_next, 0);
+
+	bluObj* viewClass = bluGetGlobal(vm, "View");
+	vm->viewClass = (bluObjClass*)viewClass;
+
+	AS_CLASS(OBJ_VAL(viewClass))->destruct = destructView;
+
+	bluDefineMethod(vm, viewClass, "len", View_len, 0);
+	bluDefineMethod(vm, viewClass, "toString", View_toString, 0);
+	bluDefineMethod(vm, viewClass, "slice", View_slice, 2);
+	bluDefineMethod(vm, viewClass, "equals", View_equals, 1);
+	bluDefineMethod(vm, viewClass, "startsWith", View_startsWith, 1);
+	bluDefineMethod(vm, viewClass, "find", View_find, 1);
+	bluDefineMethod(vm, viewClass, "toNumber", View_toNumber, 0);
 }
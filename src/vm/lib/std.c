@@ -1,12 +1,19 @@
 #include "std.h"
 
 #include "vm/lib/core/core.h"
+#include "vm/lib/event/event.h"
 #include "vm/lib/file/file.h"
 #include "vm/lib/system/system.h"
+#include "vm/lib/worker/worker.h"
+#include "vm/vm.h"
 
 void bluInitStd(bluVM* vm) {
 	bluInitCore(vm);
 
 	bluRegisterModule(vm, "system", bluInitSystem);
 	bluRegisterModule(vm, "file", bluInitFile);
+	bluRegisterModule(vm, "worker", bluInitWorker);
+	bluRegisterModule(vm, "event", bluInitEvent);
+
+	bluTraceStartup(vm, BLU_STARTUP_MODULES);
 }
@@ -1,34 +1,57 @@
-#include <time.h>
-
 #include "system.h"
+#include "vm/debug/opstats.h"
 #include "vm/memory.h"
 #include "vm/object.h"
 #include "vm/value.h"
+#include "vm/vm.h"
 
 #include "system.blu.inc"
 
 int8_t System__print(bluVM* vm, int8_t argCount, bluValue* args) {
 	for (int32_t i = 1; i <= argCount; i++) {
-		bluPrintValue(args[i]);
+		bluFormatValue(&vm->output, args[i]);
 	}
 
+	bluFlushOutputIfFull(vm);
+
 	return 1;
 }
 
 int8_t System__println(bluVM* vm, int8_t argCount, bluValue* args) {
 	if (argCount == 0) {
-		printf("\n");
+		ByteBufferAppend(&vm->output, "\n", 1);
 	}
 
 	for (int32_t i = 1; i <= argCount; i++) {
-		bluPrintValue(args[i]);
-		printf("\n");
+		bluFormatValue(&vm->output, args[i]);
+		ByteBufferAppend(&vm->output, "\n", 1);
 	}
 
+	bluFlushOutputIfFull(vm);
+
+	return 1;
+}
+
+int8_t System__flush(bluVM* vm, int8_t argCount, bluValue* args) {
+	bluFlushOutput(vm);
+
+	return 1;
+}
+
+// Sets how many bytes of output are collected before they are written out, zero writes every print at once.
+int8_t System__setOutputBuffer(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_NUMBER(args[1]) || AS_NUMBER(args[1]) < 0 || AS_NUMBER(args[1]) > INT32_MAX) return -1;
+
+	vm->outputLimit = AS_NUMBER(args[1]);
+	bluFlushOutputIfFull(vm);
+
 	return 1;
 }
 
 int8_t System__readln(bluVM* vm, int8_t argCount, bluValue* args) {
+	// A prompt printed before has to be seen before waiting for the answer.
+	bluFlushOutput(vm);
+
 	bluObjString* line = bluNewString(vm, 1024);
 
 	if (!fgets(line->chars, 1024, stdin)) {
@@ -43,7 +66,159 @@ int8_t System__readln(bluVM* vm, int8_t argCount, bluValue* args) {
 }
 
 int8_t System__clock(bluVM* vm, int8_t argCount, bluValue* args) {
-	args[0] = NUMBER_VAL((double)clock() / CLOCKS_PER_SEC);
+	args[0] = NUMBER_VAL(bluThreadClock());
+
+	return 1;
+}
+
+// Nanoseconds on the monotonic clock, from an arbitrary point in the past.
+int8_t System__nanotime(bluVM* vm, int8_t argCount, bluValue* args) {
+	args[0] = NUMBER_VAL((double)bluMonotonicTime());
+
+	return 1;
+}
+
+// Seconds on the monotonic clock, from an arbitrary point in the past.
+int8_t System__monotonic(bluVM* vm, int8_t argCount, bluValue* args) {
+	args[0] = NUMBER_VAL(bluMonotonicTime() / 1e9);
+
+	return 1;
+}
+
+static void setField(bluVM* vm, bluObjInstance* instance, const char* name, bluValue value) {
+	bluTableSet(vm, &instance->fields, bluCopyString(vm, name, strlen(name)), value);
+}
+
+// Returns the statistics of bluGetStats() as an object. Counts and bytes of objects are objects too, with a field for
+// every type.
+int8_t System__gcStats(bluVM* vm, int8_t argCount, bluValue* args) {
+	bluStats stats;
+	bluGetStats(vm, &stats);
+
+	bluObjClass* objectClass = (bluObjClass*)bluGetGlobal(vm, "Object");
+
+	bluObjArray* pauses = bluNewArray(vm, BLU_PAUSE_BUCKETS);
+	for (int32_t i = 0; i < BLU_PAUSE_BUCKETS; i++) {
+		pauses->data[i] = NUMBER_VAL((double)stats.pauses[i]);
+	}
+
+	bluObjInstance* objects = bluNewInstance(vm, objectClass);
+	bluObjInstance* objectBytes = bluNewInstance(vm, objectClass);
+
+	for (int32_t i = 0; i < BLU_OBJECT_TYPES; i++) {
+		setField(vm, objects, bluObjectTypeName(i), NUMBER_VAL((double)stats.objects[i]));
+		setField(vm, objectBytes, bluObjectTypeName(i), NUMBER_VAL((double)stats.objectBytes[i]));
+	}
+
+	bluObjInstance* result = bluNewInstance(vm, objectClass);
+	setField(vm, result, "collections", NUMBER_VAL((double)stats.collections));
+	setField(vm, result, "totalPause", NUMBER_VAL(stats.totalPause));
+	setField(vm, result, "maxPause", NUMBER_VAL(stats.maxPause));
+	setField(vm, result, "pauses", OBJ_VAL(pauses));
+	setField(vm, result, "bytesAllocated", NUMBER_VAL((double)stats.bytesAllocated));
+	setField(vm, result, "nextGC", NUMBER_VAL((double)stats.nextGC));
+	setField(vm, result, "objects", OBJ_VAL(objects));
+	setField(vm, result, "objectBytes", OBJ_VAL(objectBytes));
+	setField(vm, result, "strings", NUMBER_VAL(stats.strings));
+	setField(vm, result, "globals", NUMBER_VAL(stats.globals));
+
+	args[0] = OBJ_VAL(result);
+
+	return 1;
+}
+
+static int compareNumbers(const void* a, const void* b) {
+	double left = *(const double*)a;
+	double right = *(const double*)b;
+
+	return (left > right) - (left < right);
+}
+
+// Summarizes an array of measured times for bench(): their count, minimum, median, 99th percentile, maximum, mean and
+// standard deviation.
+int8_t System__summarize(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_ARRAY(args[1])) return -1;
+
+	bluObjArray* array = AS_ARRAY(args[1]);
+	int32_t count = array->len;
+	if (count == 0) return -1;
+
+	double* times = malloc(sizeof(double) * count);
+	double sum = 0;
+
+	for (int32_t i = 0; i < count; i++) {
+		if (!IS_NUMBER(array->data[i])) {
+			free(times);
+			return -1;
+		}
+
+		times[i] = AS_NUMBER(array->data[i]);
+		sum += times[i];
+	}
+
+	qsort(times, count, sizeof(double), compareNumbers);
+
+	double mean = sum / count;
+	double squares = 0;
+	for (int32_t i = 0; i < count; i++) {
+		squares += (times[i] - mean) * (times[i] - mean);
+	}
+
+	bluObjInstance* summary = bluNewInstance(vm, (bluObjClass*)bluGetGlobal(vm, "Object"));
+	args[0] = OBJ_VAL(summary);
+
+	setField(vm, summary, "iterations", NUMBER_VAL(count));
+	setField(vm, summary, "min", NUMBER_VAL(times[0]));
+	setField(vm, summary, "median",
+	         NUMBER_VAL(count % 2 == 1 ? times[count / 2] : (times[count / 2 - 1] + times[count / 2]) / 2));
+	setField(vm, summary, "p99", NUMBER_VAL(times[(int32_t)ceil(count * 0.99) - 1]));
+	setField(vm, summary, "max", NUMBER_VAL(times[count - 1]));
+	setField(vm, summary, "mean", NUMBER_VAL(mean));
+	setField(vm, summary, "stddev", NUMBER_VAL(count > 1 ? sqrt(squares / (count - 1)) : 0));
+
+	free(times);
+
+	return 1;
+}
+
+// Writes a snapshot of the heap to the file at the path given, returns whether it could.
+int8_t System__heapSnapshot(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_STRING(args[1])) return -1;
+
+	args[0] = BOOL_VAL(bluWriteHeapSnapshot(vm, AS_CSTRING(args[1])));
+
+	return 1;
+}
+
+// Starts tracing calls into a ring buffer of the capacity given, returns false when the VM is already traced.
+int8_t System__startTrace(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_NUMBER(args[1])) return -1;
+
+	args[0] = BOOL_VAL(bluStartTrace(vm, (int32_t)AS_NUMBER(args[1])));
+
+	return 1;
+}
+
+// Stops tracing and writes the trace to the file at the path given, returns whether it could.
+int8_t System__stopTrace(bluVM* vm, int8_t argCount, bluValue* args) {
+	if (!IS_STRING(args[1])) return -1;
+
+	FILE* file = vm->tracer != NULL ? fopen(AS_CSTRING(args[1]), "w") : NULL;
+	bluStopTrace(vm, file);
+
+	args[0] = BOOL_VAL(file != NULL);
+	if (file != NULL) fclose(file);
+
+	return 1;
+}
+
+// Returns the instruction counters of builds with BLU_OPSTATS, nil in all others.
+int8_t System__opStats(bluVM* vm, int8_t argCount, bluValue* args) {
+#ifdef BLU_OPSTATS
+	args[0] = bluOpStatsValue(vm);
+#else
+	args[0] = NIL_VAL;
+#endif
 
 	return 1;
 }
@@ -55,5 +230,15 @@ void bluInitSystem(bluVM* vm) {
 	bluDefineStaticMethod(vm, systemClass, "print", System__print, 0);
 	bluDefineStaticMethod(vm, systemClass, "println", System__println, 0);
 	bluDefineStaticMethod(vm, systemClass, "readln", System__readln, 0);
+	bluDefineStaticMethod(vm, systemClass, "flush", System__flush, 0);
+	bluDefineStaticMethod(vm, systemClass, "setOutputBuffer", System__setOutputBuffer, 1);
 	bluDefineStaticMethod(vm, systemClass, "clock", System__clock, 0);
+	bluDefineStaticMethod(vm, systemClass, "nanotime", System__nanotime, 0);
+	bluDefineStaticMethod(vm, systemClass, "monotonic", System__monotonic, 0);
+	bluDefineStaticMethod(vm, systemClass, "_summarize", System__summarize, 1);
+	bluDefineStaticMethod(vm, systemClass, "gcStats", System__gcStats, 0);
+	bluDefineStaticMethod(vm, systemClass, "heapSnapshot", System__heapSnapshot, 1);
+	bluDefineStaticMethod(vm, systemClass, "startTrace", System__startTrace, 1);
+	bluDefineStaticMethod(vm, systemClass, "stopTrace", System__stopTrace, 1);
+	bluDefineStaticMethod(vm, systemClass, "opStats", System__opStats, 0);
 }
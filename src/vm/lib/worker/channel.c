@@ -0,0 +1,47 @@
+#include "channel.h"
+
+void bluInitChannel(bluChannel* channel) {
+	atomic_init(&channel->sent, NULL);
+	channel->received = NULL;
+}
+
+static void freeMessages(bluMessage* message) {
+	while (message != NULL) {
+		bluMessage* next = message->next;
+		bluFreeMessage(message);
+		message = next;
+	}
+}
+
+void bluFreeChannel(bluChannel* channel) {
+	freeMessages(atomic_exchange(&channel->sent, NULL));
+	freeMessages(channel->received);
+
+	channel->received = NULL;
+}
+
+void bluChannelSend(bluChannel* channel, bluMessage* message) {
+	message->next = atomic_load_explicit(&channel->sent, memory_order_relaxed);
+
+	while (!atomic_compare_exchange_weak_explicit(&channel->sent, &message->next, message, memory_order_release,
+	                                              memory_order_relaxed)) {
+	}
+}
+
+bluMessage* bluChannelReceive(bluChannel* channel) {
+	if (channel->received == NULL) {
+		bluMessage* message = atomic_exchange_explicit(&channel->sent, NULL, memory_order_acquire);
+
+		while (message != NULL) {
+			bluMessage* next = message->next;
+			message->next = channel->received;
+			channel->received = message;
+			message = next;
+		}
+	}
+
+	bluMessage* message = channel->received;
+	if (message != NULL) channel->received = message->next;
+
+	return message;
+}
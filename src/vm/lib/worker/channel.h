@@ -0,0 +1,29 @@
+#ifndef blu_channel_h
+#define blu_channel_h
+
+#include <stdatomic.h>
+
+#include "include/blu.h"
+#include "message.h"
+
+// Carries messages from any number of threads to a single receiving thread without locking. Senders push onto a stack
+// with a compare and swap, the receiver takes the whole stack at once and reverses it, so messages arrive in the order
+// they were sent.
+typedef struct {
+	_Atomic(bluMessage*) sent;
+
+	// Messages taken over by the receiver, oldest first. Only the receiving thread touches these.
+	bluMessage* received;
+} bluChannel;
+
+void bluInitChannel(bluChannel* channel);
+
+// Frees the messages nobody received.
+void bluFreeChannel(bluChannel* channel);
+
+void bluChannelSend(bluChannel* channel, bluMessage* message);
+
+// Returns the oldest message not received yet, or NULL when there is none. Never blocks.
+bluMessage* bluChannelReceive(bluChannel* channel);
+
+#endif
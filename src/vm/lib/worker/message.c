@@ -0,0 +1,287 @@
+#include "message.h"
+#include "vm/object.h"
+#include "vm/vm.h"
+
+// Deepest nesting of arrays and instances in a message. Cyclic values hit it instead of recursing forever.
+#define MESSAGE_DEPTH_MAX 512
+
+typedef enum {
+	MESSAGE_NIL,
+	MESSAGE_FALSE,
+	MESSAGE_TRUE,
+	MESSAGE_NUMBER,
+	MESSAGE_STRING,
+	MESSAGE_ARRAY,
+	MESSAGE_INSTANCE,
+	MESSAGE_FUNCTION,
+	MESSAGE_CLOSURE,
+} bluMessageTag;
+
+bluMessage* bluNewMessage(bool isJob) {
+	bluMessage* message = malloc(sizeof(bluMessage));
+	ByteBufferInit(&message->data);
+	message->isJob = isJob;
+	message->next = NULL;
+
+	return message;
+}
+
+void bluFreeMessage(bluMessage* message) {
+	ByteBufferFree(&message->data);
+	free(message);
+}
+
+static void writeBytes(bluMessage* message, const void* bytes, int32_t size) {
+	ByteBufferFill(&message->data, 0, size);
+	memcpy(message->data.data + message->data.count - size, bytes, size);
+}
+
+static void readBytes(bluMessage* message, int32_t* offset, void* bytes, int32_t size) {
+	memcpy(bytes, message->data.data + *offset, size);
+	*offset += size;
+}
+
+void bluWriteInt(bluMessage* message, int32_t value) {
+	writeBytes(message, &value, sizeof(int32_t));
+}
+
+int32_t bluReadInt(bluMessage* message, int32_t* offset) {
+	int32_t value;
+	readBytes(message, offset, &value, sizeof(int32_t));
+
+	return value;
+}
+
+// Strings keep their terminating zero, so functions of a job can point at the name of their file in place.
+static void writeString(bluMessage* message, const char* chars, int32_t length) {
+	bluWriteInt(message, length);
+	writeBytes(message, chars, length + 1);
+}
+
+static const char* readString(bluMessage* message, int32_t* offset, int32_t* length) {
+	*length = bluReadInt(message, offset);
+
+	const char* chars = (const char*)message->data.data + *offset;
+	*offset += *length + 1;
+
+	return chars;
+}
+
+static bool writeValue(bluVM* vm, bluMessage* message, bluValue value, int32_t depth);
+
+static bool writeFunction(bluVM* vm, bluMessage* message, bluObjFunction* function, int32_t depth) {
+	bluChunk* chunk = &function->chunk;
+
+	ByteBufferWrite(&message->data, (uint8_t)function->arity);
+	ByteBufferWrite(&message->data, function->escapingParameters);
+	bluWriteInt(message, function->upvalueCount);
+	bluWriteInt(message, function->slotCount);
+
+	ByteBufferWrite(&message->data, function->name != NULL);
+	if (function->name != NULL) writeString(message, function->name->chars, function->name->length);
+
+	writeString(message, chunk->file, strlen(chunk->file));
+
+	bluWriteInt(message, chunk->code.count);
+	writeBytes(message, chunk->code.data, chunk->code.count);
+	writeBytes(message, chunk->lines.data, sizeof(int32_t) * chunk->code.count);
+	writeBytes(message, chunk->columns.data, sizeof(int32_t) * chunk->code.count);
+	writeBytes(message, chunk->feedback.data, chunk->code.count);
+
+	bluWriteInt(message, chunk->constants.count);
+	for (int32_t i = 0; i < chunk->constants.count; i++) {
+		if (!writeValue(vm, message, chunk->constants.data[i], depth + 1)) return false;
+	}
+
+	return true;
+}
+
+static bool writeValue(bluVM* vm, bluMessage* message, bluValue value, int32_t depth) {
+	if (depth > MESSAGE_DEPTH_MAX) return false;
+
+	switch (value.type) {
+	case VAL_NIL: ByteBufferWrite(&message->data, MESSAGE_NIL); return true;
+	case VAL_BOOL: ByteBufferWrite(&message->data, AS_BOOL(value) ? MESSAGE_TRUE : MESSAGE_FALSE); return true;
+
+	case VAL_NUMBER: {
+		double number = AS_NUMBER(value);
+
+		ByteBufferWrite(&message->data, MESSAGE_NUMBER);
+		writeBytes(message, &number, sizeof(double));
+		return true;
+	}
+
+	case VAL_OBJ: break;
+	}
+
+	switch (OBJ_TYPE(value)) {
+	case OBJ_STRING: {
+		bluObjString* string = AS_STRING(value);
+
+		ByteBufferWrite(&message->data, MESSAGE_STRING);
+		writeString(message, string->chars, string->length);
+		return true;
+	}
+
+	case OBJ_ARRAY: {
+		bluObjArray* array = AS_ARRAY(value);
+
+		ByteBufferWrite(&message->data, MESSAGE_ARRAY);
+		bluWriteInt(message, array->len);
+
+		for (int32_t i = 0; i < array->len; i++) {
+			if (!writeValue(vm, message, array->data[i], depth + 1)) return false;
+		}
+
+		return true;
+	}
+
+	case OBJ_INSTANCE: {
+		bluObjInstance* instance = AS_INSTANCE(value);
+
+		// Native data, like an open file, stays with the VM that created it.
+		if (instance->data != NULL) return false;
+
+		bluObjString* className = instance->obj.class->name;
+
+		ByteBufferWrite(&message->data, MESSAGE_INSTANCE);
+		writeString(message, className->chars, className->length);
+		bluWriteInt(message, instance->fields.count);
+
+		for (int32_t i = 0; i <= instance->fields.capacityMask; i++) {
+			bluEntry* entry = &instance->fields.entries[i];
+			if (entry->key == NULL) continue;
+
+			writeString(message, entry->key->chars, entry->key->length);
+			if (!writeValue(vm, message, entry->value, depth + 1)) return false;
+		}
+
+		return true;
+	}
+
+	case OBJ_FUNCTION: {
+		if (!message->isJob) return false;
+
+		ByteBufferWrite(&message->data, MESSAGE_FUNCTION);
+		return writeFunction(vm, message, AS_FUNCTION(value), depth);
+	}
+
+	case OBJ_CLOSURE: {
+		bluObjFunction* function = AS_CLOSURE(value)->function;
+
+		// Captured variables live in the stack and heap of the sending VM.
+		if (!message->isJob || function->upvalueCount != 0) return false;
+
+		ByteBufferWrite(&message->data, MESSAGE_CLOSURE);
+		return writeFunction(vm, message, function, depth);
+	}
+
+	default: return false;
+	}
+}
+
+bool bluWriteValue(bluVM* vm, bluMessage* message, bluValue value) {
+	return writeValue(vm, message, value, 0);
+}
+
+static bluObjFunction* readFunction(bluVM* vm, bluMessage* message, int32_t* offset) {
+	bluObjFunction* function = bluNewFunction(vm);
+	bluChunk* chunk = &function->chunk;
+
+	function->arity = (int8_t)message->data.data[(*offset)++];
+	function->escapingParameters = message->data.data[(*offset)++];
+	function->upvalueCount = bluReadInt(message, offset);
+	function->slotCount = bluReadInt(message, offset);
+
+	int32_t length;
+	if (message->data.data[(*offset)++]) {
+		const char* name = readString(message, offset, &length);
+		function->name = bluCopyString(vm, name, length);
+	}
+
+	chunk->file = readString(message, offset, &length);
+	chunk->name = function->name != NULL ? function->name->chars : "__anonymous";
+
+	int32_t count = bluReadInt(message, offset);
+
+	ByteBufferFill(&chunk->code, 0, count);
+	IntBufferFill(&chunk->lines, 0, count);
+	IntBufferFill(&chunk->columns, 0, count);
+	ByteBufferFill(&chunk->feedback, 0, count);
+
+	readBytes(message, offset, chunk->code.data, count);
+	readBytes(message, offset, chunk->lines.data, sizeof(int32_t) * count);
+	readBytes(message, offset, chunk->columns.data, sizeof(int32_t) * count);
+	readBytes(message, offset, chunk->feedback.data, count);
+
+	int32_t constantCount = bluReadInt(message, offset);
+	for (int32_t i = 0; i < constantCount; i++) {
+		bluValueBufferWrite(&chunk->constants, bluReadValue(vm, message, offset));
+	}
+
+	return function;
+}
+
+// Instances are rebuilt as instances of the global class with the same name. Without one, or when that class needs
+// native data, they become plain objects.
+static bluObjClass* findClass(bluVM* vm, const char* name) {
+	bluObj* class = bluGetGlobal(vm, name);
+
+	if (class == NULL || class->type != OBJ_CLASS || ((bluObjClass*)class)->construct != NULL) {
+		class = bluGetGlobal(vm, "Object");
+	}
+
+	return (bluObjClass*)class;
+}
+
+bluValue bluReadValue(bluVM* vm, bluMessage* message, int32_t* offset) {
+	int32_t length;
+
+	switch ((bluMessageTag)message->data.data[(*offset)++]) {
+	case MESSAGE_NIL: return NIL_VAL;
+	case MESSAGE_FALSE: return BOOL_VAL(false);
+	case MESSAGE_TRUE: return BOOL_VAL(true);
+
+	case MESSAGE_NUMBER: {
+		double number;
+		readBytes(message, offset, &number, sizeof(double));
+
+		return NUMBER_VAL(number);
+	}
+
+	case MESSAGE_STRING: {
+		const char* chars = readString(message, offset, &length);
+
+		return OBJ_VAL(bluCopyString(vm, chars, length));
+	}
+
+	case MESSAGE_ARRAY: {
+		bluObjArray* array = bluNewArray(vm, bluReadInt(message, offset));
+
+		for (int32_t i = 0; i < array->len; i++) {
+			array->data[i] = bluReadValue(vm, message, offset);
+		}
+
+		return OBJ_VAL(array);
+	}
+
+	case MESSAGE_INSTANCE: {
+		bluObjInstance* instance = bluNewInstance(vm, findClass(vm, readString(message, offset, &length)));
+
+		int32_t fieldCount = bluReadInt(message, offset);
+		for (int32_t i = 0; i < fieldCount; i++) {
+			const char* key = readString(message, offset, &length);
+			bluObjString* name = bluCopyString(vm, key, length);
+
+			bluTableSet(vm, &instance->fields, name, bluReadValue(vm, message, offset));
+		}
+
+		return OBJ_VAL(instance);
+	}
+
+	case MESSAGE_FUNCTION: return OBJ_VAL(readFunction(vm, message, offset));
+	case MESSAGE_CLOSURE: return OBJ_VAL(newClosure(vm, readFunction(vm, message, offset)));
+	}
+
+	__builtin_unreachable();
+}
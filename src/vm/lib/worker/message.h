@@ -0,0 +1,32 @@
+#ifndef blu_message_h
+#define blu_message_h
+
+#include "include/blu.h"
+#include "util/buffer.h"
+#include "vm/value.h"
+
+// Values don't cross VMs, messages do. A message holds values serialized by one VM so another one can build copies of
+// them. Only nil, booleans, numbers, strings, arrays and instances without native data can be sent. Arrays and instances
+// are copied deeply, so a value referenced twice arrives as two copies.
+typedef struct bluMessage {
+	ByteBuffer data;
+
+	// Jobs may also carry functions without upvalues. Functions read from a job point into it for the name of their
+	// file, so the job has to outlive them.
+	bool isJob;
+
+	struct bluMessage* next;
+} bluMessage;
+
+bluMessage* bluNewMessage(bool isJob);
+void bluFreeMessage(bluMessage* message);
+
+// Appends [value] to [message]. Returns false when the value, or something it references, can't be sent.
+bool bluWriteValue(bluVM* vm, bluMessage* message, bluValue value);
+void bluWriteInt(bluMessage* message, int32_t value);
+
+// Reads the value at [offset] of [message] into [vm] and moves [offset] past it.
+bluValue bluReadValue(bluVM* vm, bluMessage* message, int32_t* offset);
+int32_t bluReadInt(bluMessage* message, int32_t* offset);
+
+#endif
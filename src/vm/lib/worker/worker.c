@@ -0,0 +1,264 @@
+#include <pthread.h>
+
+#include "channel.h"
+#include "worker.h"
+#include "vm/memory.h"
+#include "vm/object.h"
+#include "vm/value.h"
+#include "vm/vm.h"
+
+#include "worker.blu.inc"
+
+typedef struct {
+	pthread_t thread;
+	bool joined;
+
+	bluImage* image;
+	bool jitEnabled;
+
+	// The job goes to the worker on [jobs], its result comes back on [results]. A result without any data means the
+	// job failed.
+	bluChannel jobs;
+	bluChannel results;
+
+	// Result taken from the channel, kept so the future can be read more than once.
+	bluMessage* result;
+} WorkerData;
+
+static void joinWorker(WorkerData* worker) {
+	if (worker->joined) return;
+
+	pthread_join(worker->thread, NULL);
+	worker->joined = true;
+}
+
+static void destruct(bluVM* vm, bluObjInstance* instance) {
+	WorkerData* worker = instance->data;
+	if (worker == NULL) return;
+
+	joinWorker(worker);
+
+	if (worker->result != NULL) bluFreeMessage(worker->result);
+
+	bluFreeChannel(&worker->jobs);
+	bluFreeChannel(&worker->results);
+
+	bluDeallocate(vm, worker, sizeof(WorkerData));
+}
+
+static char* readScript(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) return NULL;
+
+	fseek(file, 0L, SEEK_END);
+	size_t fileSize = ftell(file);
+	rewind(file);
+
+	char* buffer = malloc(fileSize + 1);
+	size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
+	buffer[bytesRead] = '\0';
+
+	fclose(file);
+	return buffer;
+}
+
+// Runs [job] in [vm] and writes its result to [result]. The job starts with the modules and the top level functions of
+// the parent, followed by the function to call, or the path of the script to run, and its arguments.
+static bool runJob(bluVM* vm, bluMessage* job, bluMessage* result) {
+	int32_t offset = 0;
+
+	int32_t moduleCount = bluReadInt(job, &offset);
+	for (int32_t i = 0; i < moduleCount; i++) {
+		bluObjString* name = AS_STRING(bluReadValue(vm, job, &offset));
+
+		char* source = malloc(name->length + 16);
+		sprintf(source, "import \"%s\"", name->chars);
+
+		bluInterpretResult imported = bluInterpret(vm, source, "__WORKER__");
+		free(source);
+
+		if (imported != INTERPRET_OK) return false;
+	}
+
+	int32_t globalCount = bluReadInt(job, &offset);
+	for (int32_t i = 0; i < globalCount; i++) {
+		bluObjString* name = AS_STRING(bluReadValue(vm, job, &offset));
+
+		bluTableSet(vm, &vm->globals, name, bluReadValue(vm, job, &offset));
+	}
+
+	bluValue callee = bluReadValue(vm, job, &offset);
+	bluPush(vm, callee);
+
+	if (IS_STRING(callee)) {
+		char* source = readScript(AS_CSTRING(callee));
+		if (source == NULL) {
+			fprintf(stderr, "Could not open file \"%s\".\n", AS_CSTRING(callee));
+			return false;
+		}
+
+		// The path stays on the stack, functions of the script point at it as the name of their file.
+		bluInterpretResult interpreted = bluInterpret(vm, source, AS_CSTRING(callee));
+		free(source);
+
+		return interpreted == INTERPRET_OK && bluWriteValue(vm, result, NIL_VAL);
+	}
+
+	int32_t argCount = bluReadInt(job, &offset);
+	for (int32_t i = 0; i < argCount; i++) {
+		bluPush(vm, bluReadValue(vm, job, &offset));
+	}
+
+	if (bluCall(vm, argCount) != INTERPRET_OK) return false;
+
+	if (!bluWriteValue(vm, result, bluPeek(vm, 0))) {
+		fprintf(stderr, "Result of the worker can't be sent to another VM.\n");
+		return false;
+	}
+
+	return true;
+}
+
+static void* runWorker(void* data) {
+	WorkerData* worker = data;
+
+	bluVMConfig config;
+	bluInitVMConfig(&config);
+	config.image = worker->image;
+
+	bluVM* vm = bluNewVMWithConfig(&config);
+	bluSetJitEnabled(vm, worker->jitEnabled);
+
+	bluMessage* job = bluChannelReceive(&worker->jobs);
+	bluMessage* result = bluNewMessage(false);
+
+	if (!runJob(vm, job, result)) result->data.count = 0;
+
+	bluChannelSend(&worker->results, result);
+
+	// Functions of the job point into it, it has to outlive the VM.
+	bluFreeVM(vm);
+	bluFreeMessage(job);
+
+	return NULL;
+}
+
+static bool writeJob(bluVM* vm, bluMessage* job, int8_t argCount, bluValue* args) {
+	int32_t moduleCount = 0;
+	for (int32_t i = 0; i < vm->modules.count; i++) {
+		if (vm->modules.data[i].loaded) moduleCount++;
+	}
+
+	bluWriteInt(job, moduleCount);
+	for (int32_t i = 0; i < vm->modules.count; i++) {
+		if (vm->modules.data[i].loaded) bluWriteValue(vm, job, OBJ_VAL(vm->modules.data[i].name));
+	}
+
+	// Top level functions are all the worker gets of the parent's globals. Classes and variables stay behind.
+	int32_t globalCount = 0;
+	for (int32_t i = 0; i <= vm->globals.capacityMask; i++) {
+		bluEntry* entry = &vm->globals.entries[i];
+
+		if (entry->key != NULL && IS_CLOSURE(entry->value) && !AS_OBJ(entry->value)->isShared &&
+		    AS_CLOSURE(entry->value)->function->upvalueCount == 0) {
+			globalCount++;
+		}
+	}
+
+	bluWriteInt(job, globalCount);
+	for (int32_t i = 0; i <= vm->globals.capacityMask; i++) {
+		bluEntry* entry = &vm->globals.entries[i];
+
+		if (entry->key != NULL && IS_CLOSURE(entry->value) && !AS_OBJ(entry->value)->isShared &&
+		    AS_CLOSURE(entry->value)->function->upvalueCount == 0) {
+			bluWriteValue(vm, job, OBJ_VAL(entry->key));
+			if (!bluWriteValue(vm, job, entry->value)) return false;
+		}
+	}
+
+	if (!bluWriteValue(vm, job, args[1])) return false;
+
+	bluWriteInt(job, argCount - 1);
+	for (int32_t i = 2; i <= argCount; i++) {
+		if (!bluWriteValue(vm, job, args[i])) return false;
+	}
+
+	return true;
+}
+
+int8_t Worker__spawn(bluVM* vm, int8_t argCount, bluValue* args) {
+	bluMessage* job = bluNewMessage(true);
+
+	if (!writeJob(vm, job, argCount, args)) {
+		bluFreeMessage(job);
+		return -1;
+	}
+
+	WorkerData* worker = bluAllocate(vm, sizeof(WorkerData));
+	worker->joined = false;
+	worker->image = vm->image;
+	worker->jitEnabled = vm->jitEnabled;
+	worker->result = NULL;
+
+	bluInitChannel(&worker->jobs);
+	bluInitChannel(&worker->results);
+
+	bluChannelSend(&worker->jobs, job);
+
+	if (pthread_create(&worker->thread, NULL, runWorker, worker) != 0) {
+		bluFreeChannel(&worker->jobs);
+		bluDeallocate(vm, worker, sizeof(WorkerData));
+		return -1;
+	}
+
+	bluObjInstance* future = bluNewInstance(vm, (bluObjClass*)bluGetGlobal(vm, "Future"));
+	future->data = worker;
+
+	args[0] = OBJ_VAL(future);
+
+	return 1;
+}
+
+int8_t Future_get(bluVM* vm, int8_t argCount, bluValue* args) {
+	WorkerData* worker = AS_INSTANCE(args[0])->data;
+	if (worker == NULL) return -1;
+
+	if (worker->result == NULL) worker->result = bluChannelReceive(&worker->results);
+
+	if (worker->result == NULL) {
+		joinWorker(worker);
+		worker->result = bluChannelReceive(&worker->results);
+	}
+
+	if (worker->result->data.count == 0) return -1;
+
+	int32_t offset = 0;
+	args[0] = bluReadValue(vm, worker->result, &offset);
+
+	return 1;
+}
+
+int8_t Future_isDone(bluVM* vm, int8_t argCount, bluValue* args) {
+	WorkerData* worker = AS_INSTANCE(args[0])->data;
+	if (worker == NULL) return -1;
+
+	if (worker->result == NULL) worker->result = bluChannelReceive(&worker->results);
+
+	args[0] = BOOL_VAL(worker->result != NULL);
+
+	return 1;
+}
+
+void bluInitWorker(bluVM* vm) {
+	bluInterpret(vm, workerSource, "__WORKER__");
+
+	bluObj* workerClass = bluGetGlobal(vm, "Worker");
+	bluDefineStaticMethod(vm, workerClass, "spawn", Worker__spawn, 1);
+
+	bluObj* futureClass = bluGetGlobal(vm, "Future");
+
+	AS_CLASS(OBJ_VAL(futureClass))->destruct = destruct;
+
+	bluDefineMethod(vm, futureClass, "get", Future_get, 0);
+	bluDefineMethod(vm, futureClass, "isDone", Future_isDone, 0);
+}
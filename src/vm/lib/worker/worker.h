@@ -0,0 +1,8 @@
+#ifndef blu_worker_h
+#define blu_worker_h
+
+#include "include/blu.h"
+
+void bluInitWorker(bluVM* vm);
+
+#endif
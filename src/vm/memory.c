@@ -1,10 +1,27 @@
 #include "memory.h"
 #include "vm/common.h"
+#include "vm/image.h"
+#include "vm/jit/jit.h"
 #include "vm/vm.h"
 
 #define GC_HEAP_GROW_FACTOR 2
 #define GC_HEAP_MINIMUM 1024 * 1024
 
+_Static_assert(BLU_OBJECT_TYPES == OBJ_UPVALUE + 1, "Every object type needs its statistics.");
+
+static const char* objectTypeNames[] = {
+	[OBJ_ARRAY] = "array",
+	[OBJ_BOUND_METHOD] = "boundMethod",
+	[OBJ_CLASS] = "class",
+	[OBJ_CLOSURE] = "closure",
+	[OBJ_FIBER] = "fiber",
+	[OBJ_FUNCTION] = "function",
+	[OBJ_INSTANCE] = "instance",
+	[OBJ_NATIVE] = "native",
+	[OBJ_STRING] = "string",
+	[OBJ_UPVALUE] = "upvalue",
+};
+
 static void freeObject(bluVM* vm, bluObj* object) {
 
 #ifdef DEBUG_GC_TRACE
@@ -43,9 +60,20 @@ static void freeObject(bluVM* vm, bluObj* object) {
 		break;
 	}
 
+	case OBJ_FIBER: {
+		bluObjFiber* fiber = (bluObjFiber*)object;
+		free(fiber->stack);
+		free(fiber->frames);
+		bluDeallocate(vm, fiber, sizeof(bluObjFiber));
+		break;
+	}
+
 	case OBJ_FUNCTION: {
 		bluObjFunction* function = (bluObjFunction*)object;
 		bluChunkFree(&function->chunk);
+#ifdef BLU_JIT
+		bluJitFree(function);
+#endif
 		bluDeallocate(vm, function, sizeof(bluObjFunction));
 		break;
 	}
@@ -102,6 +130,9 @@ void bluGrayObject(bluVM* vm, bluObj* object) {
 
 	if (object->isDark) return;
 
+	// Shared objects only reference other shared objects and are freed with their image.
+	if (object->isShared) return;
+
 #ifdef DEBUG_GC_TRACE
 	printf("%p gray ", object);
 	bluPrintValue(OBJ_VAL(object));
@@ -146,6 +177,29 @@ void bluGrayObject(bluVM* vm, bluObj* object) {
 		break;
 	}
 
+	case OBJ_FIBER: {
+		bluObjFiber* fiber = (bluObjFiber*)object;
+		bluGrayValue(vm, fiber->callee);
+		bluGrayObject(vm, (bluObj*)fiber->caller);
+
+		for (bluValue* slot = fiber->stack; slot < fiber->stackTop; slot++) {
+			bluGrayValue(vm, *slot);
+		}
+
+		for (int32_t i = 0; i < fiber->frameCount; i++) {
+			bluGrayObject(vm, (bluObj*)fiber->frames[i].closure);
+		}
+
+		for (bluObjUpvalue* upvalue = fiber->openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+			bluGrayObject(vm, (bluObj*)upvalue);
+		}
+
+		for (bluObj* regionObject = fiber->regionObjects; regionObject != NULL; regionObject = regionObject->next) {
+			bluGrayObject(vm, regionObject);
+		}
+		break;
+	}
+
 	case OBJ_FUNCTION: {
 		bluObjFunction* function = (bluObjFunction*)object;
 		bluGrayObject(vm, (bluObj*)function->name);
@@ -160,12 +214,15 @@ void bluGrayObject(bluVM* vm, bluObj* object) {
 	}
 
 	case OBJ_NATIVE: {
+		bluObjNative* native = (bluObjNative*)object;
+		bluGrayObject(vm, (bluObj*)native->name);
 		break;
 	}
 
 	case OBJ_UPVALUE: {
+		// Open upvalues may point into the stack of a fiber nobody references any more.
 		bluObjUpvalue* upvalue = (bluObjUpvalue*)object;
-		bluGrayValue(vm, upvalue->closed);
+		bluGrayValue(vm, *upvalue->value);
 		break;
 	}
 
@@ -182,7 +239,7 @@ void bluGrayValueBuffer(bluVM* vm, bluValueBuffer* buffer) {
 }
 
 void bluGrayTable(bluVM* vm, bluTable* table) {
-	for (int32_t i = 0; i < table->capacityMask; i++) {
+	for (int32_t i = 0; i <= table->capacityMask; i++) {
 		bluEntry* entry = &table->entries[i];
 		bluGrayObject(vm, (bluObj*)entry->key);
 		bluGrayValue(vm, entry->value);
@@ -216,6 +273,58 @@ void bluDeallocate(bluVM* vm, void* pointer, size_t size) {
 	bluReallocate(vm, pointer, size, 0);
 }
 
+void bluReleaseRegion(bluVM* vm, uint8_t* mark) {
+	// Frames entered before the region was allocated have no mark.
+	if (mark == NULL) mark = vm->region;
+
+	while (vm->regionObjects != NULL && (uint8_t*)vm->regionObjects >= mark) {
+		bluObj* object = vm->regionObjects;
+		vm->regionObjects = object->next;
+
+		// Only the buffers are owned by the object, the object itself lives in the region.
+		switch (object->type) {
+		case OBJ_ARRAY: {
+			bluObjArray* array = (bluObjArray*)object;
+			bluDeallocate(vm, array->data, (sizeof(bluValue) * array->cap));
+			break;
+		}
+
+		case OBJ_CLOSURE: {
+			bluObjClosure* closure = (bluObjClosure*)object;
+			bluObjUpvalueBufferFree(&closure->upvalues);
+			break;
+		}
+
+		default: break;
+		}
+	}
+
+	vm->regionTop = mark;
+}
+
+// Unlinks the fibers about to be freed. Their open upvalues may still be reachable through closures, those are closed
+// so they no longer point into the stack. Region objects are never swept, the ones of the remaining fibers are unmarked.
+static void sweepFibers(bluVM* vm) {
+	bluObjFiber** fiber = &vm->fibers;
+
+	while (*fiber != NULL) {
+		if (!(*fiber)->obj.isDark) {
+			for (bluObjUpvalue* upvalue = (*fiber)->openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+				upvalue->closed = *upvalue->value;
+				upvalue->value = &upvalue->closed;
+			}
+
+			*fiber = (*fiber)->nextFiber;
+		} else {
+			for (bluObj* object = (*fiber)->regionObjects; object != NULL; object = object->next) {
+				object->isDark = false;
+			}
+
+			fiber = &(*fiber)->nextFiber;
+		}
+	}
+}
+
 void bluCollectGarbage(bluVM* vm) {
 #ifdef DEBUG_GC_TRACE
 	printf("-- gc begin\n");
@@ -223,7 +332,8 @@ void bluCollectGarbage(bluVM* vm) {
 	size_t before = vm->bytesAllocated;
 #endif
 
-	double start = (double)clock() / CLOCKS_PER_SEC;
+	// Pauses are wall time, which is what the script waits for.
+	int64_t start = bluMonotonicTime();
 
 	for (bluValue* slot = vm->stack; slot < vm->stackTop; slot++) {
 		bluGrayValue(vm, *slot);
@@ -233,6 +343,14 @@ void bluCollectGarbage(bluVM* vm) {
 		bluGrayObject(vm, (bluObj*)vm->frames[i].closure);
 	}
 
+	for (bluObjUpvalue* upvalue = vm->openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+		bluGrayObject(vm, (bluObj*)upvalue);
+	}
+
+	bluGrayObject(vm, (bluObj*)vm->fiber);
+	bluGrayObject(vm, (bluObj*)vm->resumed);
+	bluGrayValue(vm, vm->transfer);
+
 	for (int32_t i = 0; i < vm->modules.count; i++) {
 		bluGrayObject(vm, (bluObj*)vm->modules.data[i].name);
 	}
@@ -241,6 +359,23 @@ void bluCollectGarbage(bluVM* vm) {
 
 	bluGrayObject(vm, (bluObj*)vm->stringInitializer);
 
+	// Scripts may replace the globals these came from.
+	bluGrayObject(vm, (bluObj*)vm->mappingClass);
+	bluGrayObject(vm, (bluObj*)vm->linesClass);
+	bluGrayObject(vm, (bluObj*)vm->viewClass);
+
+	if (vm->image != NULL) {
+		for (int32_t i = 0; i < vm->image->classCount; i++) {
+			bluGrayObject(vm, (bluObj*)vm->sharedClasses[i]);
+		}
+	}
+
+	for (bluObj* object = vm->regionObjects; object != NULL; object = object->next) {
+		bluGrayObject(vm, object);
+	}
+
+	sweepFibers(vm);
+
 	tableDeleteWhite(vm, &vm->strings);
 
 	// Collect the white objects.
@@ -258,9 +393,24 @@ void bluCollectGarbage(bluVM* vm) {
 		}
 	}
 
+	// Region objects are never swept, unmark them here.
+	for (bluObj* object = vm->regionObjects; object != NULL; object = object->next) {
+		object->isDark = false;
+	}
+
 	vm->nextGC = vm->bytesAllocated < GC_HEAP_MINIMUM ? GC_HEAP_MINIMUM : vm->bytesAllocated * GC_HEAP_GROW_FACTOR;
 	vm->shouldGC = false;
-	vm->timeGC += ((double)clock() / CLOCKS_PER_SEC) - start;
+
+	if (vm->tracer != NULL) bluTraceSpan(vm, TRACE_GC, "GC", start);
+
+	double pause = (bluMonotonicTime() - start) / 1e9;
+	vm->gcCount++;
+	vm->timeGC += pause;
+	if (pause > vm->maxPauseGC) vm->maxPauseGC = pause;
+
+	int32_t bucket = 0;
+	for (double limit = 0.0001; bucket < BLU_PAUSE_BUCKETS - 1 && pause > limit; limit *= 10) bucket++;
+	vm->gcPauses[bucket]++;
 
 #ifdef DEBUG_GC_TRACE
 	printf("-- gc collected %ld bytes (from %ld to %ld) next at %ld\n", before - vm->bytesAllocated, before,
@@ -276,3 +426,67 @@ void bluCollectMemory(bluVM* vm) {
 		object = next;
 	}
 }
+
+static size_t tableSize(bluTable* table) {
+	return table->entries != NULL ? sizeof(bluEntry) * (table->capacityMask + 1) : 0;
+}
+
+size_t bluObjectSize(bluObj* object) {
+	switch (object->type) {
+	case OBJ_ARRAY: return sizeof(bluObjArray) + sizeof(bluValue) * ((bluObjArray*)object)->cap;
+	case OBJ_BOUND_METHOD: return sizeof(bluObjBoundMethod);
+
+	case OBJ_CLASS: {
+		bluObjClass* class = (bluObjClass*)object;
+		return sizeof(bluObjClass) + tableSize(&class->methods) + tableSize(&class->fields);
+	}
+
+	case OBJ_CLOSURE:
+		return sizeof(bluObjClosure) + sizeof(bluObjUpvalue*) * ((bluObjClosure*)object)->upvalues.capacity;
+
+	case OBJ_FIBER: {
+		bluObjFiber* fiber = (bluObjFiber*)object;
+		return sizeof(bluObjFiber) + sizeof(bluValue) * fiber->stackSize + sizeof(bluCallFrame) * fiber->frameSize;
+	}
+
+	case OBJ_FUNCTION: {
+		bluChunk* chunk = &((bluObjFunction*)object)->chunk;
+		return sizeof(bluObjFunction) + chunk->code.capacity + sizeof(int32_t) * chunk->lines.capacity +
+		       sizeof(int32_t) * chunk->columns.capacity + chunk->feedback.capacity +
+		       sizeof(bluValue) * chunk->constants.capacity;
+	}
+
+	case OBJ_INSTANCE: return sizeof(bluObjInstance) + tableSize(&((bluObjInstance*)object)->fields);
+	case OBJ_NATIVE: return sizeof(bluObjNative);
+	case OBJ_STRING: return sizeof(bluObjString) + ((bluObjString*)object)->length + 1;
+	case OBJ_UPVALUE: return sizeof(bluObjUpvalue);
+	}
+
+	__builtin_unreachable();
+}
+
+const char* bluObjectTypeName(int32_t type) {
+	return type >= 0 && type < BLU_OBJECT_TYPES ? objectTypeNames[type] : "unknown";
+}
+
+void bluGetStats(bluVM* vm, bluStats* stats) {
+	memset(stats, 0, sizeof(bluStats));
+
+	stats->collections = vm->gcCount;
+	stats->totalPause = vm->timeGC;
+	stats->maxPause = vm->maxPauseGC;
+	memcpy(stats->pauses, vm->gcPauses, sizeof(stats->pauses));
+
+	stats->bytesAllocated = vm->bytesAllocated;
+	stats->nextGC = vm->nextGC;
+
+	for (bluObj* object = vm->objects; object != NULL; object = object->next) {
+		stats->objects[object->type]++;
+		stats->objectBytes[object->type] += bluObjectSize(object);
+	}
+
+	stats->strings = vm->strings.count;
+	stats->stringsCapacity = vm->strings.capacityMask + 1;
+	stats->globals = vm->globals.count;
+	stats->globalsCapacity = vm->globals.capacityMask + 1;
+}
@@ -14,6 +14,12 @@ void bluGrayObject(bluVM* vm, bluObj* object);
 void bluGrayValueBuffer(bluVM* vm, bluValueBuffer* buffer);
 void bluGrayTable(bluVM* vm, bluTable* table);
 
+// Releases every region object allocated above [mark] and resets the top of the region to it.
+void bluReleaseRegion(bluVM* vm, uint8_t* mark);
+
+// Returns the bytes taken by [object] and the buffers it owns.
+size_t bluObjectSize(bluObj* object);
+
 void bluCollectGarbage(bluVM* vm);
 void bluCollectMemory(bluVM* vm);
 
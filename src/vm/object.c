@@ -1,5 +1,6 @@
 #include "object.h"
 #include "include/blu.h"
+#include "vm/image.h"
 #include "vm/memory.h"
 #include "vm/table.h"
 #include "vm/vm.h"
@@ -7,10 +8,13 @@
 DEFINE_BUFFER(bluObjUpvalue, bluObjUpvalue*);
 
 static bluObj* allocateObject(bluVM* vm, size_t size, bluObjType type) {
+	if (vm->allocationProfiler != NULL) bluSampleAllocation(vm, size);
+
 	bluObj* object = (bluObj*)bluAllocate(vm, size);
 	object->type = type;
 	object->class = NULL;
 	object->isDark = false;
+	object->isShared = false;
 	object->next = vm->objects;
 
 	vm->objects = object;
@@ -18,6 +22,46 @@ static bluObj* allocateObject(bluVM* vm, size_t size, bluObjType type) {
 	return object;
 }
 
+// Allocates an object in the region of the current frame. Falls back to the heap once the region is full.
+static bluObj* allocateRegionObject(bluVM* vm, size_t size, bluObjType type) {
+	size_t alignedSize = (size + 7) & ~(size_t)7;
+
+	// Fibers keep their frames across switches, which would break the order regions are released in. They use the heap.
+	if (vm->fiber != NULL) return allocateObject(vm, size, type);
+
+	// The region is only allocated once needed, VMs which never use it stay small.
+	if (vm->region == NULL) {
+		vm->region = malloc(REGION_SIZE);
+		vm->regionTop = vm->region;
+	}
+
+	if (vm->regionTop + alignedSize > vm->region + REGION_SIZE) {
+		return allocateObject(vm, size, type);
+	}
+
+	bluObj* object = (bluObj*)vm->regionTop;
+	object->type = type;
+	object->class = NULL;
+	object->isDark = false;
+	object->isShared = false;
+	object->next = vm->regionObjects;
+
+	vm->regionTop += alignedSize;
+	vm->regionObjects = object;
+
+	return object;
+}
+
+// Looks up a string interned by this VM or by its image.
+static bluObjString* findString(bluVM* vm, const char* chars, int32_t length, int32_t hash) {
+	if (vm->image != NULL) {
+		bluObjString* shared = bluTableFindString(vm, &vm->image->vm->strings, chars, length, hash);
+		if (shared != NULL) return shared;
+	}
+
+	return bluTableFindString(vm, &vm->strings, chars, length, hash);
+}
+
 static int32_t hashString(const char* key, int32_t length) {
 	int32_t hash = 2166136261u;
 
@@ -37,7 +81,7 @@ static bluObjString* allocateString(bluVM* vm, const char* chars, int32_t length
 	string->length = length;
 	string->hash = hash;
 
-	strncpy(string->chars, chars, length);
+	memcpy(string->chars, chars, length);
 
 	string->chars[length] = '\0';
 
@@ -49,14 +93,13 @@ static bluObjString* allocateString(bluVM* vm, const char* chars, int32_t length
 bluObjString* bluCopyString(bluVM* vm, const char* chars, int32_t length) {
 	int32_t hash = hashString(chars, length);
 
-	bluObjString* interned = bluTableFindString(vm, &vm->strings, chars, length, hash);
+	bluObjString* interned = findString(vm, chars, length, hash);
 	if (interned != NULL) return interned;
 
 	return allocateString(vm, chars, length, hash);
 }
 
-bluObjArray* bluNewArray(bluVM* vm, int32_t len) {
-	bluObjArray* array = (bluObjArray*)allocateObject(vm, sizeof(bluObjArray), OBJ_ARRAY);
+static bluObjArray* initArray(bluVM* vm, bluObjArray* array, int32_t len) {
 	array->obj.class = vm->arrayClass;
 	array->cap = bluPowerOf2Ceil(len);
 	array->len = len;
@@ -65,8 +108,16 @@ bluObjArray* bluNewArray(bluVM* vm, int32_t len) {
 	return array;
 }
 
-bluObjBoundMethod* bluNewBoundMethod(bluVM* vm, bluValue receiver, bluObjClosure* closure) {
-	bluObjBoundMethod* method = (bluObjBoundMethod*)allocateObject(vm, sizeof(bluObjBoundMethod), OBJ_BOUND_METHOD);
+bluObjArray* bluNewArray(bluVM* vm, int32_t len) {
+	return initArray(vm, (bluObjArray*)allocateObject(vm, sizeof(bluObjArray), OBJ_ARRAY), len);
+}
+
+bluObjArray* bluNewRegionArray(bluVM* vm, int32_t len) {
+	return initArray(vm, (bluObjArray*)allocateRegionObject(vm, sizeof(bluObjArray), OBJ_ARRAY), len);
+}
+
+static bluObjBoundMethod* initBoundMethod(bluVM* vm, bluObjBoundMethod* method, bluValue receiver,
+										  bluObjClosure* closure) {
 	method->obj.class = vm->functionClass;
 	method->receiver = receiver;
 	method->closure = closure;
@@ -74,6 +125,19 @@ bluObjBoundMethod* bluNewBoundMethod(bluVM* vm, bluValue receiver, bluObjClosure
 	return method;
 }
 
+bluObjBoundMethod* bluNewBoundMethod(bluVM* vm, bluValue receiver, bluObjClosure* closure) {
+	bluObjBoundMethod* method = (bluObjBoundMethod*)allocateObject(vm, sizeof(bluObjBoundMethod), OBJ_BOUND_METHOD);
+
+	return initBoundMethod(vm, method, receiver, closure);
+}
+
+bluObjBoundMethod* bluNewRegionBoundMethod(bluVM* vm, bluValue receiver, bluObjClosure* closure) {
+	bluObjBoundMethod* method =
+		(bluObjBoundMethod*)allocateRegionObject(vm, sizeof(bluObjBoundMethod), OBJ_BOUND_METHOD);
+
+	return initBoundMethod(vm, method, receiver, closure);
+}
+
 bluObjClass* bluNewClass(bluVM* vm, bluObjString* name) {
 	bluObjClass* class = (bluObjClass*)allocateObject(vm, sizeof(bluObjClass), OBJ_CLASS);
 	class->obj.class = vm->classClass;
@@ -81,6 +145,7 @@ bluObjClass* bluNewClass(bluVM* vm, bluObjString* name) {
 	class->name = name;
 	class->construct = NULL;
 	class->destruct = NULL;
+	class->sharedIndex = -1;
 
 	bluTableInit(vm, &class->methods);
 	bluTableInit(vm, &class->fields);
@@ -88,8 +153,7 @@ bluObjClass* bluNewClass(bluVM* vm, bluObjString* name) {
 	return class;
 }
 
-bluObjClosure* newClosure(bluVM* vm, bluObjFunction* function) {
-	bluObjClosure* closure = (bluObjClosure*)allocateObject(vm, sizeof(bluObjClosure), OBJ_CLOSURE);
+static bluObjClosure* initClosure(bluVM* vm, bluObjClosure* closure, bluObjFunction* function) {
 	closure->obj.class = vm->functionClass;
 	closure->function = function;
 
@@ -98,13 +162,59 @@ bluObjClosure* newClosure(bluVM* vm, bluObjFunction* function) {
 	return closure;
 }
 
+bluObjClosure* newClosure(bluVM* vm, bluObjFunction* function) {
+	return initClosure(vm, (bluObjClosure*)allocateObject(vm, sizeof(bluObjClosure), OBJ_CLOSURE), function);
+}
+
+bluObjClosure* bluNewRegionClosure(bluVM* vm, bluObjFunction* function) {
+	return initClosure(vm, (bluObjClosure*)allocateRegionObject(vm, sizeof(bluObjClosure), OBJ_CLOSURE), function);
+}
+
+bluObjFiber* bluNewFiber(bluVM* vm, bluValue callee) {
+	bluObjFiber* fiber = (bluObjFiber*)allocateObject(vm, sizeof(bluObjFiber), OBJ_FIBER);
+	fiber->obj.class = vm->fiberClass;
+	fiber->state = FIBER_NEW;
+	fiber->callee = callee;
+	fiber->caller = NULL;
+
+	fiber->stack = malloc(sizeof(bluValue) * FIBER_STACK_SIZE);
+	fiber->stackSize = FIBER_STACK_SIZE;
+	fiber->stackTop = fiber->stack;
+
+	// The callee sits in the first slot, like the closure of a script.
+	*fiber->stackTop++ = callee;
+
+	fiber->frames = malloc(sizeof(bluCallFrame) * FIBER_FRAME_SIZE);
+	fiber->frameCount = 0;
+	fiber->frameCountStart = 0;
+	fiber->frameSize = FIBER_FRAME_SIZE;
+
+	fiber->openUpvalues = NULL;
+
+	fiber->region = NULL;
+	fiber->regionTop = NULL;
+	fiber->regionObjects = NULL;
+
+	fiber->nextFiber = vm->fibers;
+	vm->fibers = fiber;
+
+	return fiber;
+}
+
 bluObjFunction* bluNewFunction(bluVM* vm) {
 	bluObjFunction* function = (bluObjFunction*)allocateObject(vm, sizeof(bluObjFunction), OBJ_FUNCTION);
 	function->obj.class = vm->functionClass;
 	function->arity = 0;
 	function->upvalueCount = 0;
+	function->escapingParameters = 0;
+	function->slotCount = 0;
 	function->name = NULL;
 
+#ifdef BLU_JIT
+	function->hotness = 0;
+	function->jit = NULL;
+#endif
+
 	bluChunkInit(&function->chunk);
 
 	return function;
@@ -120,11 +230,12 @@ bluObjInstance* bluNewInstance(bluVM* vm, bluObjClass* class) {
 	return instance;
 }
 
-bluObjNative* bluNewNative(bluVM* vm, bluNativeFn function, int8_t arity) {
+bluObjNative* bluNewNative(bluVM* vm, bluObjString* name, bluNativeFn function, int8_t arity) {
 	bluObjNative* native = (bluObjNative*)allocateObject(vm, sizeof(bluObjNative), OBJ_NATIVE);
 	native->obj.class = vm->functionClass;
 	native->function = function;
 	native->arity = arity;
+	native->name = name;
 
 	return native;
 }
@@ -151,10 +262,41 @@ bluObjUpvalue* bluNewUpvalue(bluVM* vm, bluValue* slot) {
 	return upvalue;
 }
 
+bluObj* bluPromoteObject(bluVM* vm, bluObj* object) {
+	size_t size;
+
+	switch (object->type) {
+	case OBJ_ARRAY: size = sizeof(bluObjArray); break;
+	case OBJ_BOUND_METHOD: size = sizeof(bluObjBoundMethod); break;
+	case OBJ_CLOSURE: size = sizeof(bluObjClosure); break;
+	default: __builtin_unreachable();
+	}
+
+	bluObj* promoted = allocateObject(vm, size, object->type);
+	promoted->class = object->class;
+	memcpy((uint8_t*)promoted + sizeof(bluObj), (uint8_t*)object + sizeof(bluObj), size - sizeof(bluObj));
+
+	// The heap object owns the buffers now, so releasing the region must not free them.
+	switch (object->type) {
+	case OBJ_ARRAY: {
+		bluObjArray* array = (bluObjArray*)object;
+		array->data = NULL;
+		array->len = 0;
+		array->cap = 0;
+		break;
+	}
+
+	case OBJ_CLOSURE: bluObjUpvalueBufferInit(&((bluObjClosure*)object)->upvalues); break;
+	default: break;
+	}
+
+	return promoted;
+}
+
 bluObjString* bluTakeString(bluVM* vm, bluObjString* string) {
 	string->hash = hashString(string->chars, string->length);
 
-	bluObjString* interned = bluTableFindString(vm, &vm->strings, string->chars, string->length, string->hash);
+	bluObjString* interned = findString(vm, string->chars, string->length, string->hash);
 	if (interned != NULL) {
 		return interned;
 	}
@@ -164,69 +306,85 @@ bluObjString* bluTakeString(bluVM* vm, bluObjString* string) {
 	return string;
 }
 
-void bluPrintObject(bluValue value) {
+static void formatString(ByteBuffer* buffer, const char* chars) {
+	ByteBufferAppend(buffer, chars, strlen(chars));
+}
+
+// Appends [prefix], then [name] and [suffix].
+static void formatNamed(ByteBuffer* buffer, const char* prefix, bluObjString* name, const char* suffix) {
+	formatString(buffer, prefix);
+	ByteBufferAppend(buffer, name->chars, name->length);
+	formatString(buffer, suffix);
+}
+
+void bluFormatObject(ByteBuffer* buffer, bluValue value) {
 
 	switch (OBJ_TYPE(value)) {
 
 	case OBJ_ARRAY: {
 		bluObjArray* array = AS_ARRAY(value);
 
-		printf("[");
+		ByteBufferAppend(buffer, "[", 1);
 		for (int32_t i = 0; i < array->len; i++) {
 			if (i > 0) {
-				printf(", ");
+				ByteBufferAppend(buffer, ", ", 2);
 			}
 
-			bluPrintValue(array->data[i]);
+			bluFormatValue(buffer, array->data[i]);
 		}
-		printf("]");
+		ByteBufferAppend(buffer, "]", 1);
 		break;
 	}
 
 	case OBJ_BOUND_METHOD: {
-		printf("<method %s>", AS_BOUND_METHOD(value)->closure->function->name->chars);
+		formatNamed(buffer, "<method ", AS_BOUND_METHOD(value)->closure->function->name, ">");
 		break;
 	}
 
 	case OBJ_CLASS: {
-		printf("<class %s>", AS_CLASS(value)->name->chars);
+		formatNamed(buffer, "<class ", AS_CLASS(value)->name, ">");
 		break;
 	}
 
 	case OBJ_CLOSURE:
 		if (AS_CLOSURE(value)->function->name == NULL) {
-			printf("<anonymous fn>");
+			formatString(buffer, "<anonymous fn>");
 		} else {
-			printf("<fn %s>", AS_CLOSURE(value)->function->name->chars);
+			formatNamed(buffer, "<fn ", AS_CLOSURE(value)->function->name, ">");
 		}
 		break;
 
+	case OBJ_FIBER: {
+		formatString(buffer, "<fiber>");
+		break;
+	}
+
 	case OBJ_FUNCTION: {
 		if (AS_FUNCTION(value)->name == NULL) {
-			printf("<anonymous fn>");
+			formatString(buffer, "<anonymous fn>");
 		} else {
-			printf("<fn %s>", AS_FUNCTION(value)->name->chars);
+			formatNamed(buffer, "<fn ", AS_FUNCTION(value)->name, ">");
 		}
 		break;
 	}
 
 	case OBJ_INSTANCE: {
-		printf("<instance of %s>", AS_INSTANCE(value)->obj.class->name->chars);
+		formatNamed(buffer, "<instance of ", AS_INSTANCE(value)->obj.class->name, ">");
 		break;
 	}
 
 	case OBJ_NATIVE: {
-		printf("<native fn>");
+		formatString(buffer, "<native fn>");
 		break;
 	}
 
 	case OBJ_UPVALUE: {
-		printf("upvalue");
+		formatString(buffer, "upvalue");
 		break;
 	}
 
 	case OBJ_STRING: {
-		printf("%s", AS_CSTRING(value));
+		ByteBufferAppend(buffer, AS_STRING(value)->chars, AS_STRING(value)->length);
 		break;
 	}
 	}
@@ -3,6 +3,7 @@
 
 #include "compiler/chunk.h"
 #include "include/blu.h"
+#include "vm/common.h"
 #include "vm/table.h"
 #include "vm/value.h"
 
@@ -12,6 +13,7 @@
 #define IS_BOUND_METHOD(value) bluIsObjType(value, OBJ_BOUND_METHOD)
 #define IS_CLASS(value) bluIsObjType(value, OBJ_CLASS)
 #define IS_CLOSURE(value) bluIsObjType(value, OBJ_CLOSURE)
+#define IS_FIBER(value) bluIsObjType(value, OBJ_FIBER)
 #define IS_FUNCTION(value) bluIsObjType(value, OBJ_FUNCTION)
 #define IS_INSTANCE(value) bluIsObjType(value, OBJ_INSTANCE)
 #define IS_NATIVE(value) bluIsObjType(value, OBJ_NATIVE)
@@ -21,6 +23,7 @@
 #define AS_BOUND_METHOD(value) ((bluObjBoundMethod*)AS_OBJ(value))
 #define AS_CLASS(value) ((bluObjClass*)AS_OBJ(value))
 #define AS_CLOSURE(value) ((bluObjClosure*)AS_OBJ(value))
+#define AS_FIBER(value) ((bluObjFiber*)AS_OBJ(value))
 #define AS_FUNCTION(value) ((bluObjFunction*)AS_OBJ(value))
 #define AS_INSTANCE(value) ((bluObjInstance*)AS_OBJ(value))
 #define AS_NATIVE(value) ((bluObjNative*)AS_OBJ(value))
@@ -32,11 +35,16 @@ typedef struct bluObjArray bluObjArray;
 typedef struct bluObjBoundMethod bluObjBoundMethod;
 typedef struct bluObjClass bluObjClass;
 typedef struct bluObjClosure bluObjClosure;
+typedef struct bluObjFiber bluObjFiber;
 typedef struct bluObjFunction bluObjFunction;
 typedef struct bluObjInstance bluObjInstance;
 typedef struct bluObjNative bluObjNative;
 typedef struct bluObjUpvalue bluObjUpvalue;
 
+typedef struct bluJitCode bluJitCode;
+
+typedef struct bluCallFrame bluCallFrame;
+
 DECLARE_BUFFER(bluObjUpvalue, bluObjUpvalue*);
 
 typedef void (*bluConstruct)(bluVM* vm, bluObjInstance* instance);
@@ -47,6 +55,7 @@ typedef enum {
 	OBJ_BOUND_METHOD,
 	OBJ_CLASS,
 	OBJ_CLOSURE,
+	OBJ_FIBER,
 	OBJ_FUNCTION,
 	OBJ_INSTANCE,
 	OBJ_NATIVE,
@@ -54,11 +63,22 @@ typedef enum {
 	OBJ_UPVALUE,
 } bluObjType;
 
+typedef enum {
+	FIBER_NEW,
+	FIBER_SUSPENDED,
+	FIBER_RUNNING,
+	FIBER_DONE,
+} bluFiberState;
+
 struct bluObj {
 	bluObjType type;
 	bluObjClass* class;
 
 	bool isDark;
+
+	// Shared objects belong to an image and are never marked, freed or changed by the VMs using it.
+	bool isShared;
+
 	bluObj* next;
 };
 
@@ -83,6 +103,9 @@ struct bluObjClass {
 	bluTable fields;
 	bluConstruct construct;
 	bluDestruct destruct;
+
+	// Index of a shared class in the image, used to find the copy a VM made of it.
+	int32_t sharedIndex;
 };
 
 struct bluObjClosure {
@@ -91,12 +114,58 @@ struct bluObjClosure {
 	bluObjUpvalueBuffer upvalues;
 };
 
+struct bluObjFiber {
+	bluObj obj;
+	bluFiberState state;
+
+	// Function the fiber runs, called on the first resume.
+	bluValue callee;
+
+	// Fiber which resumed this one, while it runs.
+	bluObjFiber* caller;
+
+	// Stacks of the fiber while it is not running. While it runs, they hold the stacks of its caller instead, every
+	// switch swaps them with the stacks of the VM.
+	bluValue* stack;
+	bluValue* stackTop;
+	int32_t stackSize;
+
+	bluCallFrame* frames;
+	int32_t frameCount;
+	int32_t frameCountStart;
+	int32_t frameSize;
+
+	bluObjUpvalue* openUpvalues;
+
+	uint8_t* region;
+	uint8_t* regionTop;
+	bluObj* regionObjects;
+
+	// All fibers of a VM are linked, so the GC can close the open upvalues of the ones it frees.
+	bluObjFiber* nextFiber;
+};
+
 struct bluObjFunction {
 	bluObj obj;
 	int8_t arity;
 	uint16_t upvalueCount;
+
+	// Bit i is set if the i-th parameter may outlive the call, e.g. by being stored or returned. Functions take at most
+	// eight parameters today, any past the eighth would have no bit and always count as escaping.
+	uint8_t escapingParameters;
+
+	// Number of stack slots taken by the function at its deepest, locals and temporaries. Calls make sure the stack has
+	// room for these plus STACK_HEADROOM values.
+	int32_t slotCount;
+
 	bluChunk chunk;
 	bluObjString* name;
+
+#ifdef BLU_JIT
+	// Number of calls and loop iterations so far, used to decide when to compile the function.
+	int32_t hotness;
+	bluJitCode* jit;
+#endif
 };
 
 struct bluObjInstance {
@@ -109,6 +178,9 @@ struct bluObjNative {
 	bluObj obj;
 	int8_t arity;
 	bluNativeFn function;
+
+	// Name of the method the native was defined as, for traces.
+	bluObjString* name;
 };
 
 struct bluObjString {
@@ -133,19 +205,27 @@ struct bluObjUpvalue {
 };
 
 bluObjArray* bluNewArray(bluVM* vm, int32_t len);
+bluObjArray* bluNewRegionArray(bluVM* vm, int32_t len);
 bluObjBoundMethod* bluNewBoundMethod(bluVM* vm, bluValue receiver, bluObjClosure* closure);
+bluObjBoundMethod* bluNewRegionBoundMethod(bluVM* vm, bluValue receiver, bluObjClosure* closure);
 bluObjClass* bluNewClass(bluVM* vm, bluObjString* name);
 bluObjClosure* newClosure(bluVM* vm, bluObjFunction* function);
+bluObjClosure* bluNewRegionClosure(bluVM* vm, bluObjFunction* function);
+bluObjFiber* bluNewFiber(bluVM* vm, bluValue callee);
 bluObjFunction* bluNewFunction(bluVM* vm);
 bluObjInstance* bluNewInstance(bluVM* vm, bluObjClass* class);
-bluObjNative* bluNewNative(bluVM* vm, bluNativeFn function, int8_t arity);
+bluObjNative* bluNewNative(bluVM* vm, bluObjString* name, bluNativeFn function, int8_t arity);
 bluObjString* bluNewString(bluVM* vm, int32_t length);
 bluObjUpvalue* bluNewUpvalue(bluVM* vm, bluValue* slot);
 
 bluObjString* bluCopyString(bluVM* vm, const char* chars, int32_t length);
 bluObjString* bluTakeString(bluVM* vm, bluObjString* string);
 
-void bluPrintObject(bluValue value);
+// Moves a region allocated array, closure or bound method to the heap and returns the heap copy. The caller has to
+// replace every reference to the region object, which is left empty.
+bluObj* bluPromoteObject(bluVM* vm, bluObj* object);
+
+void bluFormatObject(ByteBuffer* buffer, bluValue value);
 
 static inline bool bluIsObjType(bluValue value, bluObjType type) {
 	return IS_OBJ(value) && AS_OBJ(value)->type == type;
@@ -0,0 +1,86 @@
+#include <pthread.h>
+
+#include "include/blu.h"
+#include "vm/vm.h"
+
+struct bluVMPool {
+	pthread_mutex_t lock;
+
+	bluVMConfig config;
+
+	// Image loaded by the pool itself when the config didn't name one.
+	bluImage* ownImage;
+
+	bluVM** idle;
+	int32_t idleCount;
+	int32_t idleCapacity;
+};
+
+bluVMPool* bluNewVMPool(int32_t size, const bluVMConfig* config) {
+	bluVMPool* pool = malloc(sizeof(bluVMPool));
+	pthread_mutex_init(&pool->lock, NULL);
+
+	if (config != NULL) {
+		pool->config = *config;
+	} else {
+		bluInitVMConfig(&pool->config);
+	}
+
+	// VMs can only be reset when they come from an image.
+	pool->ownImage = NULL;
+	if (pool->config.image == NULL) {
+		pool->ownImage = bluNewImage();
+		pool->config.image = pool->ownImage;
+	}
+
+	pool->idleCapacity = size > 0 ? size : 1;
+	pool->idle = malloc(sizeof(bluVM*) * pool->idleCapacity);
+	pool->idleCount = 0;
+
+	for (int32_t i = 0; i < size; i++) {
+		pool->idle[pool->idleCount++] = bluNewVMWithConfig(&pool->config);
+	}
+
+	return pool;
+}
+
+void bluFreeVMPool(bluVMPool* pool) {
+	for (int32_t i = 0; i < pool->idleCount; i++) {
+		bluFreeVM(pool->idle[i]);
+	}
+
+	if (pool->ownImage != NULL) bluFreeImage(pool->ownImage);
+
+	pthread_mutex_destroy(&pool->lock);
+
+	free(pool->idle);
+	free(pool);
+}
+
+bluVM* bluAcquireVM(bluVMPool* pool) {
+	bluVM* vm = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->idleCount > 0) vm = pool->idle[--pool->idleCount];
+	pthread_mutex_unlock(&pool->lock);
+
+	// Creating a VM from the image only reads the image, so it doesn't need the lock.
+	if (vm == NULL) vm = bluNewVMWithConfig(&pool->config);
+
+	return vm;
+}
+
+void bluReleaseVM(bluVMPool* pool, bluVM* vm) {
+	bluResetVM(vm);
+
+	pthread_mutex_lock(&pool->lock);
+
+	if (pool->idleCount == pool->idleCapacity) {
+		pool->idleCapacity *= 2;
+		pool->idle = realloc(pool->idle, sizeof(bluVM*) * pool->idleCapacity);
+	}
+
+	pool->idle[pool->idleCount++] = vm;
+
+	pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,258 @@
+#include "profiler.h"
+
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "vm/vm.h"
+
+#define PROFILE_TABLE_SIZE 1024
+
+// Older C libraries only have the field of the union behind it.
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+// Sample flag of the VM profiled on this thread. The timer signals only the thread that started it, so the handler
+// always runs on the thread whose flag it sets, and the flag is gone before its VM can be.
+static _Thread_local volatile sig_atomic_t* sampleFlag = NULL;
+
+static void requestSample(int signal) {
+	if (sampleFlag != NULL) *sampleFlag = 1;
+}
+
+static uint32_t hashStack(const uint8_t* chars, int32_t length) {
+	uint32_t hash = 2166136261u;
+
+	for (int32_t i = 0; i < length; i++) {
+		hash ^= chars[i];
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+static bluProfileEntry* findEntry(bluProfileEntry* entries, int32_t capacityMask, const uint8_t* stack, int32_t length,
+                                  uint32_t hash) {
+	for (uint32_t index = hash & capacityMask;; index = (index + 1) & capacityMask) {
+		bluProfileEntry* entry = &entries[index];
+
+		if (entry->stack == NULL) return entry;
+		if (entry->hash == hash && entry->length == length && memcmp(entry->stack, stack, length) == 0) return entry;
+	}
+}
+
+static void growTable(bluProfiler* profiler) {
+	int32_t capacityMask = profiler->capacityMask * 2 + 1;
+	bluProfileEntry* entries = calloc(capacityMask + 1, sizeof(bluProfileEntry));
+
+	for (int32_t i = 0; i <= profiler->capacityMask; i++) {
+		bluProfileEntry* entry = &profiler->entries[i];
+		if (entry->stack == NULL) continue;
+
+		*findEntry(entries, capacityMask, (uint8_t*)entry->stack, entry->length, entry->hash) = *entry;
+	}
+
+	free(profiler->entries);
+	profiler->entries = entries;
+	profiler->capacityMask = capacityMask;
+}
+
+// Adds [weight] to the entry of the stack being taken.
+static void recordStack(bluProfiler* profiler, int64_t weight) {
+	ByteBuffer* stack = &profiler->stack;
+
+	uint32_t hash = hashStack(stack->data, stack->count);
+	bluProfileEntry* entry = findEntry(profiler->entries, profiler->capacityMask, stack->data, stack->count, hash);
+
+	if (entry->stack == NULL) {
+		entry->stack = malloc(stack->count);
+		memcpy(entry->stack, stack->data, stack->count);
+		entry->length = stack->count;
+		entry->hash = hash;
+		entry->count = 0;
+
+		if (++profiler->count * 4 > (profiler->capacityMask + 1) * 3) {
+			growTable(profiler);
+			entry = findEntry(profiler->entries, profiler->capacityMask, stack->data, stack->count, hash);
+		}
+	}
+
+	entry->count += weight;
+}
+
+// Appends the function of [frame] with the line it is executing to the stack being taken.
+static void writeFrame(bluProfiler* profiler, bluCallFrame* frame) {
+	bluChunk* chunk = &frame->closure->function->chunk;
+
+	// The IP is sitting on the next instruction to be executed.
+	int32_t instruction = (int32_t)(frame->ip - chunk->code.data) - 1;
+	if (instruction < 0) instruction = 0;
+
+	char location[256];
+	int32_t length =
+	    snprintf(location, sizeof(location), "%s (%s:%d)", chunk->name, chunk->file, chunk->lines.data[instruction]);
+	if (length >= (int32_t)sizeof(location)) length = sizeof(location) - 1;
+
+	ByteBufferAppend(&profiler->stack, location, length);
+}
+
+static bluProfiler* newProfiler() {
+	bluProfiler* profiler = malloc(sizeof(bluProfiler));
+
+	profiler->entries = calloc(PROFILE_TABLE_SIZE, sizeof(bluProfileEntry));
+	profiler->count = 0;
+	profiler->capacityMask = PROFILE_TABLE_SIZE - 1;
+	ByteBufferInit(&profiler->stack);
+	profiler->interval = 0;
+	profiler->untilSample = 0;
+
+	return profiler;
+}
+
+static int compareEntries(const void* a, const void* b) {
+	int64_t left = ((const bluProfileEntry*)a)->count;
+	int64_t right = ((const bluProfileEntry*)b)->count;
+
+	return (left < right) - (left > right);
+}
+
+// Writes the entries of [profiler] to [file], unless it's NULL, largest first, and frees the profiler.
+static void freeProfiler(bluProfiler* profiler, FILE* file) {
+	// Moves the entries to the front of the table.
+	int32_t count = 0;
+	for (int32_t i = 0; i <= profiler->capacityMask; i++) {
+		if (profiler->entries[i].stack != NULL) profiler->entries[count++] = profiler->entries[i];
+	}
+
+	qsort(profiler->entries, count, sizeof(bluProfileEntry), compareEntries);
+
+	for (int32_t i = 0; i < count; i++) {
+		bluProfileEntry* entry = &profiler->entries[i];
+
+		if (file != NULL) fprintf(file, "%.*s %" PRId64 "\n", entry->length, entry->stack, entry->count);
+		free(entry->stack);
+	}
+
+	if (file != NULL) fflush(file);
+
+	free(profiler->entries);
+	ByteBufferFree(&profiler->stack);
+	free(profiler);
+}
+
+void bluTakeSample(bluVM* vm) {
+	vm->shouldSample = 0;
+
+	bluProfiler* profiler = vm->profiler;
+	if (profiler == NULL) return;
+
+	profiler->stack.count = 0;
+
+	// Collapsed stacks start with the outermost frame.
+	for (int32_t i = 0; i < vm->frameCount; i++) {
+		if (i != 0) ByteBufferWrite(&profiler->stack, ';');
+		writeFrame(profiler, &vm->frames[i]);
+	}
+
+	if (profiler->stack.count == 0) return;
+
+	recordStack(profiler, 1);
+}
+
+void bluSampleAllocation(bluVM* vm, size_t size) {
+	bluProfiler* profiler = vm->allocationProfiler;
+
+	profiler->untilSample -= (int64_t)size;
+	if (profiler->untilSample > 0) return;
+
+	// Every sample stands for the bytes of one interval, allocations spanning several intervals take several samples.
+	int64_t samples = 1 - profiler->untilSample / profiler->interval;
+	profiler->untilSample += samples * profiler->interval;
+
+	profiler->stack.count = 0;
+
+	// Natives allocate in the frame of their caller. Without any frame, it's the compiler allocating.
+	if (vm->frameCount > 0) {
+		writeFrame(profiler, &vm->frames[vm->frameCount - 1]);
+	} else {
+		ByteBufferAppend(&profiler->stack, "(compiler)", 10);
+	}
+
+	recordStack(profiler, samples * profiler->interval);
+}
+
+bool bluStartProfiler(bluVM* vm, int32_t frequency) {
+	if (vm->profiler != NULL || sampleFlag != NULL || frequency <= 0) return false;
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = requestSample;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+
+	if (sigaction(SIGPROF, &action, NULL) != 0) return false;
+
+	bluProfiler* profiler = newProfiler();
+
+	// Time is measured on the CPU clock of the calling thread, so VMs on other threads, and time spent waiting, don't
+	// count.
+	struct sigevent event;
+	memset(&event, 0, sizeof(event));
+	event.sigev_notify = SIGEV_THREAD_ID;
+	event.sigev_signo = SIGPROF;
+	event.sigev_notify_thread_id = gettid();
+
+	if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &profiler->timer) != 0) {
+		freeProfiler(profiler, NULL);
+		return false;
+	}
+
+	vm->profiler = profiler;
+	vm->shouldSample = 0;
+	sampleFlag = &vm->shouldSample;
+
+	int64_t interval = 1000000000 / frequency;
+
+	struct itimerspec spec;
+	spec.it_interval.tv_sec = interval / 1000000000;
+	spec.it_interval.tv_nsec = interval % 1000000000;
+	spec.it_value = spec.it_interval;
+
+	timer_settime(profiler->timer, 0, &spec, NULL);
+
+	return true;
+}
+
+void bluStopProfiler(bluVM* vm, FILE* file) {
+	bluProfiler* profiler = vm->profiler;
+	if (profiler == NULL) return;
+
+	timer_delete(profiler->timer);
+
+	sampleFlag = NULL;
+	vm->shouldSample = 0;
+	vm->profiler = NULL;
+
+	freeProfiler(profiler, file);
+}
+
+bool bluStartAllocationProfiler(bluVM* vm, int64_t interval) {
+	if (vm->allocationProfiler != NULL || interval <= 0) return false;
+
+	bluProfiler* profiler = newProfiler();
+	profiler->interval = interval;
+	profiler->untilSample = interval;
+
+	vm->allocationProfiler = profiler;
+
+	return true;
+}
+
+void bluStopAllocationProfiler(bluVM* vm, FILE* file) {
+	bluProfiler* profiler = vm->allocationProfiler;
+	if (profiler == NULL) return;
+
+	vm->allocationProfiler = NULL;
+
+	freeProfiler(profiler, file);
+}
@@ -0,0 +1,42 @@
+#ifndef blu_profiler_h
+#define blu_profiler_h
+
+#include "include/blu.h"
+
+#include <signal.h>
+
+#include "util/buffer.h"
+
+// Distinct call stack, formatted as a line of collapsed stack output, and the number of samples that caught it. For
+// allocations, the stack is the single frame allocating and the count the bytes allocated there.
+typedef struct {
+	char* stack;
+	int32_t length;
+	uint32_t hash;
+	int64_t count;
+} bluProfileEntry;
+
+typedef struct {
+	timer_t timer;
+
+	// Open addressing table of the stacks seen so far.
+	bluProfileEntry* entries;
+	int32_t count;
+	int32_t capacityMask;
+
+	// Stack of the sample being taken.
+	ByteBuffer stack;
+
+	// Bytes allocated between two allocation samples and the bytes left until the next one.
+	int64_t interval;
+	int64_t untilSample;
+} bluProfiler;
+
+// Records the call stack of [vm]. Called by the interpreter once the timer asks for a sample.
+void bluTakeSample(bluVM* vm);
+
+// Counts [size] bytes towards the next sample of the allocation profiler, which has to be running, and records the
+// allocating frame once the sample is due.
+void bluSampleAllocation(bluVM* vm, size_t size);
+
+#endif
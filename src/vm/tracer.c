@@ -0,0 +1,244 @@
+#include "tracer.h"
+
+#include <inttypes.h>
+#include <unistd.h>
+
+#include "util/utils.h"
+#include "vm/vm.h"
+
+#define TRACE_NAMES_SIZE 256
+#define TRACE_TRACKS_SIZE 16
+
+// Number of functions started and not yet ended on a track, among the events written so far.
+typedef struct {
+	uintptr_t track;
+	int64_t depth;
+	bool isUsed;
+} TrackDepth;
+
+typedef struct {
+	TrackDepth* entries;
+	int32_t count;
+	int32_t mask;
+} TrackDepths;
+
+static const char* categoryNames[] = {
+	[TRACE_FUNCTION] = "function",
+	[TRACE_NATIVE] = "native",
+	[TRACE_GC] = "gc",
+};
+
+static uint32_t hashPointer(const char* pointer) {
+	uint64_t bits = (uint64_t)(uintptr_t)pointer;
+
+	return (uint32_t)((bits >> 3) * 0x9E3779B97F4A7C15u >> 32);
+}
+
+static bluTraceName* findName(bluTraceName* names, int32_t nameMask, const char* key) {
+	for (uint32_t index = hashPointer(key) & nameMask;; index = (index + 1) & nameMask) {
+		bluTraceName* name = &names[index];
+
+		// Names of freed functions may be at the address of a new one, the characters have to match as well.
+		if (name->key == NULL) return name;
+		if (name->key == key && strcmp(name->copy, key) == 0) return name;
+	}
+}
+
+// Returns a copy of [key] owned by the tracer, events keep names of functions which may be collected before the trace
+// is written.
+static const char* copyName(bluTracer* tracer, const char* key) {
+	bluTraceName* name = findName(tracer->names, tracer->nameMask, key);
+	if (name->key != NULL) return name->copy;
+
+	name->key = key;
+	name->copy = strdup(key);
+
+	const char* copy = name->copy;
+
+	if (++tracer->nameCount * 2 > tracer->nameMask + 1) {
+		int32_t nameMask = tracer->nameMask * 2 + 1;
+		bluTraceName* names = calloc(nameMask + 1, sizeof(bluTraceName));
+
+		for (int32_t i = 0; i <= tracer->nameMask; i++) {
+			bluTraceName* old = &tracer->names[i];
+			if (old->key == NULL) continue;
+
+			// Probes by the address only, entries sharing one stay in the order they were added.
+			uint32_t index = hashPointer(old->key) & nameMask;
+			while (names[index].key != NULL) index = (index + 1) & nameMask;
+
+			names[index] = *old;
+		}
+
+		free(tracer->names);
+		tracer->names = names;
+		tracer->nameMask = nameMask;
+	}
+
+	return copy;
+}
+
+static void record(bluVM* vm, char phase, bluTraceCategory category, const char* name, int64_t time,
+                   int64_t duration) {
+	bluTracer* tracer = vm->tracer;
+	bluTraceEvent* event = &tracer->events[tracer->count++ % tracer->capacity];
+
+	event->time = time;
+	event->duration = duration;
+	event->name = name;
+	event->track = (uintptr_t)vm->fiber;
+	event->phase = phase;
+	event->category = category;
+}
+
+void bluTraceEnter(bluVM* vm, bluObjFunction* function) {
+	record(vm, 'B', TRACE_FUNCTION, copyName(vm->tracer, function->chunk.name), bluMonotonicTime(), 0);
+}
+
+void bluTraceExit(bluVM* vm) {
+	record(vm, 'E', TRACE_FUNCTION, NULL, bluMonotonicTime(), 0);
+}
+
+void bluTraceUnwind(bluVM* vm) {
+	for (int32_t i = 0; i < vm->frameCount; i++) {
+		bluTraceExit(vm);
+	}
+}
+
+void bluTraceSpan(bluVM* vm, bluTraceCategory category, const char* name, int64_t start) {
+	record(vm, 'X', category, copyName(vm->tracer, name), start, bluMonotonicTime() - start);
+}
+
+bool bluStartTrace(bluVM* vm, int32_t capacity) {
+	if (vm->tracer != NULL || capacity <= 0) return false;
+
+	bluTracer* tracer = malloc(sizeof(bluTracer));
+	tracer->events = malloc(sizeof(bluTraceEvent) * capacity);
+	tracer->capacity = capacity;
+	tracer->count = 0;
+	tracer->names = calloc(TRACE_NAMES_SIZE, sizeof(bluTraceName));
+	tracer->nameCount = 0;
+	tracer->nameMask = TRACE_NAMES_SIZE - 1;
+	tracer->startTime = bluMonotonicTime();
+
+	vm->tracer = tracer;
+
+	// Functions already running start with the trace, so their ends have starts to match.
+	for (int32_t i = 0; i < vm->frameCount; i++) {
+		bluTraceEnter(vm, vm->frames[i].closure->function);
+	}
+
+	return true;
+}
+
+static TrackDepth* findTrack(TrackDepth* entries, int32_t mask, uintptr_t track) {
+	for (uint32_t index = hashPointer((const char*)track) & mask;; index = (index + 1) & mask) {
+		TrackDepth* entry = &entries[index];
+
+		if (!entry->isUsed || entry->track == track) return entry;
+	}
+}
+
+// Returns the depth of [track], adding it when it's new.
+static int64_t* trackDepth(TrackDepths* depths, uintptr_t track) {
+	TrackDepth* entry = findTrack(depths->entries, depths->mask, track);
+	if (entry->isUsed) return &entry->depth;
+
+	entry->track = track;
+	entry->isUsed = true;
+
+	if (++depths->count * 2 > depths->mask + 1) {
+		int32_t mask = depths->mask * 2 + 1;
+		TrackDepth* entries = calloc(mask + 1, sizeof(TrackDepth));
+
+		for (int32_t i = 0; i <= depths->mask; i++) {
+			if (depths->entries[i].isUsed) *findTrack(entries, mask, depths->entries[i].track) = depths->entries[i];
+		}
+
+		free(depths->entries);
+		depths->entries = entries;
+		depths->mask = mask;
+
+		entry = findTrack(entries, mask, track);
+	}
+
+	return &entry->depth;
+}
+
+static void writeEscaped(FILE* file, const char* chars) {
+	for (; *chars != '\0'; chars++) {
+		if (*chars == '"' || *chars == '\\') {
+			fprintf(file, "\\%c", *chars);
+		} else if ((uint8_t)*chars < 0x20) {
+			fprintf(file, "\\u%04x", *chars);
+		} else {
+			fputc(*chars, file);
+		}
+	}
+}
+
+static void writeEvent(FILE* file, bluTracer* tracer, bluTraceEvent* event, int32_t pid) {
+	fprintf(file, ",\n{\"ph\":\"%c\",\"cat\":\"%s\",\"pid\":%d,\"tid\":%" PRIuPTR ",\"ts\":%.3f", event->phase,
+	        categoryNames[event->category], pid, event->track, (event->time - tracer->startTime) / 1e3);
+
+	if (event->phase == 'X') fprintf(file, ",\"dur\":%.3f", event->duration / 1e3);
+
+	if (event->name != NULL) {
+		fputs(",\"name\":\"", file);
+		writeEscaped(file, event->name);
+		fputc('"', file);
+	}
+
+	fputc('}', file);
+}
+
+void bluStopTrace(bluVM* vm, FILE* file) {
+	bluTracer* tracer = vm->tracer;
+	if (tracer == NULL) return;
+
+	// Functions still running end with the trace.
+	bluTraceUnwind(vm);
+
+	vm->tracer = NULL;
+
+	if (file != NULL) {
+		int32_t pid = getpid();
+
+		fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+		fprintf(file, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"blu\"}}", pid);
+
+		TrackDepths depths;
+		depths.entries = calloc(TRACE_TRACKS_SIZE, sizeof(TrackDepth));
+		depths.count = 0;
+		depths.mask = TRACE_TRACKS_SIZE - 1;
+
+		// Once the ring buffer is full, the oldest event is the one to be overwritten next.
+		int64_t first = tracer->count > tracer->capacity ? tracer->count - tracer->capacity : 0;
+		for (int64_t i = first; i < tracer->count; i++) {
+			bluTraceEvent* event = &tracer->events[i % tracer->capacity];
+			int64_t* depth = trackDepth(&depths, event->track);
+
+			// Functions running when their starts were overwritten end without them, their ends are left out too.
+			if (event->phase == 'B') (*depth)++;
+			if (event->phase == 'E') {
+				if (*depth == 0) continue;
+				(*depth)--;
+			}
+
+			writeEvent(file, tracer, event, pid);
+		}
+
+		free(depths.entries);
+
+		fprintf(file, "\n]}\n");
+		fflush(file);
+	}
+
+	for (int32_t i = 0; i <= tracer->nameMask; i++) {
+		free(tracer->names[i].copy);
+	}
+
+	free(tracer->names);
+	free(tracer->events);
+	free(tracer);
+}
@@ -0,0 +1,56 @@
+#ifndef blu_tracer_h
+#define blu_tracer_h
+
+#include "include/blu.h"
+#include "vm/object.h"
+
+typedef enum {
+	TRACE_FUNCTION,
+	TRACE_NATIVE,
+	TRACE_GC,
+} bluTraceCategory;
+
+// Event of the Chrome trace format: the start ('B') or the end ('E') of a function, or a complete span ('X') of a
+// native or a collection. [track] is the fiber the event happened on, 0 for the stacks of the VM itself.
+typedef struct {
+	int64_t time;
+	int64_t duration;
+	const char* name;
+	uintptr_t track;
+	char phase;
+	uint8_t category;
+} bluTraceEvent;
+
+// Copy of a name events refer to, which outlives the function or the native it came from.
+typedef struct {
+	const char* key;
+	char* copy;
+} bluTraceName;
+
+typedef struct {
+	// Ring buffer of the last [capacity] events, [count] is the number of events recorded so far.
+	bluTraceEvent* events;
+	int64_t capacity;
+	int64_t count;
+
+	// Open addressing table of names by the address they were recorded from.
+	bluTraceName* names;
+	int32_t nameCount;
+	int32_t nameMask;
+
+	int64_t startTime;
+} bluTracer;
+
+// Records the start of [function] on the running fiber.
+void bluTraceEnter(bluVM* vm, bluObjFunction* function);
+
+// Records the end of the innermost function on the running fiber.
+void bluTraceExit(bluVM* vm);
+
+// Records the end of every function on the running fiber, when its stack is thrown away.
+void bluTraceUnwind(bluVM* vm);
+
+// Records a span named [name], of a native or a collection, from [start] until now.
+void bluTraceSpan(bluVM* vm, bluTraceCategory category, const char* name, int64_t start);
+
+#endif
@@ -1,6 +1,7 @@
 #include <math.h>
 
 #include "value.h"
+#include "util/format.h"
 #include "vm/object.h"
 
 bool bluValuesEqual(bluValue a, bluValue b) {
@@ -20,18 +21,32 @@ bool bluIsFalsey(bluValue value) {
 	return (IS_BOOL(value) && AS_BOOL(value) == false) || IS_NIL(value);
 }
 
-void bluPrintValue(bluValue value) {
+void bluFormatValue(ByteBuffer* buffer, bluValue value) {
 	switch (value.type) {
-	case VAL_BOOL: printf(AS_BOOL(value) ? "true" : "false"); break;
-	case VAL_NIL: printf("nil"); break;
-	case VAL_NUMBER: {
-		if (AS_NUMBER(value) == (int)AS_NUMBER(value)) {
-			printf("%d", (int)AS_NUMBER(value));
+	case VAL_BOOL: {
+		if (AS_BOOL(value)) {
+			ByteBufferAppend(buffer, "true", 4);
 		} else {
-			printf("%g", AS_NUMBER(value));
+			ByteBufferAppend(buffer, "false", 5);
 		}
 		break;
 	}
-	case VAL_OBJ: bluPrintObject(value); break;
+	case VAL_NIL: ByteBufferAppend(buffer, "nil", 3); break;
+	case VAL_NUMBER: {
+		char chars[NUMBER_FORMAT_MAX];
+		ByteBufferAppend(buffer, chars, bluFormatNumber(AS_NUMBER(value), chars));
+		break;
+	}
+	case VAL_OBJ: bluFormatObject(buffer, value); break;
 	}
 }
+
+void bluPrintValue(bluValue value) {
+	ByteBuffer buffer;
+	ByteBufferInit(&buffer);
+
+	bluFormatValue(&buffer, value);
+	fwrite(buffer.data, sizeof(uint8_t), buffer.count, stdout);
+
+	ByteBufferFree(&buffer);
+}
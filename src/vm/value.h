@@ -2,6 +2,7 @@
 #define blu_value_h
 
 #include "include/blu.h"
+#include "util/buffer.h"
 
 typedef enum {
 	VAL_BOOL,
@@ -37,4 +38,7 @@ bool bluValuesEqual(bluValue a, bluValue b);
 bool bluIsFalsey(bluValue value);
 void bluPrintValue(bluValue value);
 
+// Appends the printed form of [value] to [buffer].
+void bluFormatValue(ByteBuffer* buffer, bluValue value);
+
 #endif
@@ -1,30 +1,119 @@
 #include "vm.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+
 #include "compiler/compiler.h"
 #include "lib/std.h"
 #include "vm/debug/debug.h"
+#include "vm/debug/opstats.h"
+#include "vm/image.h"
+#include "vm/jit/jit.h"
 #include "vm/memory.h"
 #include "vm/object.h"
 
-#define BINARY_OP(valueType, op)                                                                                       \
+#define BINARY_OP(valueType, op, quickOp)                                                                              \
 	do {                                                                                                               \
 		if (!IS_NUMBER(PEEK(0)) || !IS_NUMBER(PEEK(1))) {                                                              \
 			RUNTIME_ERROR("Operands must be numbers.");                                                                \
 			return INTERPRET_RUNTIME_ERROR;                                                                            \
 		}                                                                                                              \
                                                                                                                        \
+		quicken(frame, FEEDBACK_NUMBER, quickOp);                                                                      \
+                                                                                                                       \
 		double right = AS_NUMBER(POP());                                                                               \
 		double left = AS_NUMBER(POP());                                                                                \
 		PUSH(valueType(left op right));                                                                                \
 	} while (false)
 
+// Quickened form of BINARY_OP. Falls back to [genericOp] when either operand is not a number.
+#define NUMBER_OP(valueType, op, genericOp)                                                                            \
+	do {                                                                                                               \
+		if (!IS_NUMBER(PEEK(0)) || !IS_NUMBER(PEEK(1))) {                                                              \
+			deoptimize(frame, genericOp);                                                                              \
+		} else {                                                                                                       \
+			vm->stackTop[-2] = valueType(AS_NUMBER(vm->stackTop[-2]) op AS_NUMBER(vm->stackTop[-1]));                  \
+			DROP();                                                                                                    \
+		}                                                                                                              \
+	} while (false)
+
+#ifdef BLU_REGISTER_VM
+#define BINARY_OP_RK(valueType, op)                                                                                    \
+	do {                                                                                                               \
+		bluValue left = READ_RK();                                                                                     \
+		bluValue right = READ_RK();                                                                                    \
+                                                                                                                       \
+		if (!IS_NUMBER(left) || !IS_NUMBER(right)) {                                                                   \
+			RUNTIME_ERROR("Operands must be numbers.");                                                                \
+			return INTERPRET_RUNTIME_ERROR;                                                                            \
+		}                                                                                                              \
+                                                                                                                       \
+		PUSH(valueType(AS_NUMBER(left) op AS_NUMBER(right)));                                                          \
+	} while (false)
+#endif
+
 DEFINE_BUFFER(bluModule, bluModule);
 
 static void resetStack(bluVM* vm) {
+	if (vm->tracer != NULL) bluTraceUnwind(vm);
+
 	vm->stackTop = vm->stack;
 	vm->frameCount = 0;
+
+	bluReleaseRegion(vm, vm->region);
+}
+
+#define SWAP(type, a, b)                                                                                               \
+	do {                                                                                                               \
+		type swapped = a;                                                                                              \
+		a = b;                                                                                                         \
+		b = swapped;                                                                                                   \
+	} while (false)
+
+static bool callValue(bluVM* vm, bluValue callee, int8_t argCount);
+static void closeUpvalues(bluVM* vm, bluValue* last);
+
+// Exchanges the stacks of the VM with the ones kept in [fiber].
+static void swapStacks(bluVM* vm, bluObjFiber* fiber) {
+	SWAP(bluValue*, vm->stack, fiber->stack);
+	SWAP(bluValue*, vm->stackTop, fiber->stackTop);
+	SWAP(int32_t, vm->stackSize, fiber->stackSize);
+	SWAP(bluCallFrame*, vm->frames, fiber->frames);
+	SWAP(int32_t, vm->frameCount, fiber->frameCount);
+	SWAP(int32_t, vm->frameCountStart, fiber->frameCountStart);
+	SWAP(int32_t, vm->frameSize, fiber->frameSize);
+	SWAP(bluObjUpvalue*, vm->openUpvalues, fiber->openUpvalues);
+	SWAP(uint8_t*, vm->region, fiber->region);
+	SWAP(uint8_t*, vm->regionTop, fiber->regionTop);
+	SWAP(bluObj*, vm->regionObjects, fiber->regionObjects);
+}
+
+// Suspends the running fiber and returns to the one which resumed it. [value] becomes the result of its resume call.
+static void leaveFiber(bluVM* vm, bluFiberState state, bluValue value) {
+	bluObjFiber* fiber = vm->fiber;
+	fiber->state = state;
+
+	// A finished fiber keeps nothing alive.
+	if (state == FIBER_DONE) {
+		if (vm->tracer != NULL) bluTraceUnwind(vm);
+
+		closeUpvalues(vm, vm->stack);
+		vm->stackTop = vm->stack;
+		vm->frameCount = 0;
+	}
+
+	swapStacks(vm, fiber);
+
+	vm->fiber = fiber->caller;
+	fiber->caller = NULL;
+
+	vm->stackTop[-1] = value;
 }
 
 static void runtimeError(bluVM* vm, const char* format, ...) {
+	bluFlushOutput(vm);
+
 	va_list args;
 	va_start(args, format);
 	vfprintf(stderr, format, args);
@@ -42,6 +131,11 @@ static void runtimeError(bluVM* vm, const char* format, ...) {
 		fprintf(stderr, "%s\n", function->chunk.name);
 	}
 
+	// An error ends every fiber on the way back to the stacks of the VM.
+	while (vm->fiber != NULL) {
+		leaveFiber(vm, FIBER_DONE, NIL_VAL);
+	}
+
 	resetStack(vm);
 }
 
@@ -60,17 +154,91 @@ static void concatenate(bluVM* vm) {
 	bluPush(vm, OBJ_VAL(result));
 }
 
+// Records [feedback] for the instruction just read from [frame] and rewrites it to [quickOp] as long as it hasn't seen
+// operands of any other type.
+static inline void quicken(bluCallFrame* frame, uint8_t feedback, bluOpCode quickOp) {
+	bluObjFunction* function = frame->closure->function;
+	bluChunk* chunk = &function->chunk;
+	int32_t offset = frame->ip - 1 - chunk->code.data;
+
+	// Code from an image is shared by many VMs, which are not allowed to change it.
+	if (function->obj.isShared) return;
+
+	chunk->feedback.data[offset] |= feedback;
+
+	if (chunk->feedback.data[offset] == feedback) frame->ip[-1] = quickOp;
+}
+
+// Rewrites a quickened instruction whose guard failed back to [genericOp] and executes it again. The generic
+// instruction records the new operand types, so it never gets quickened again.
+static inline void deoptimize(bluCallFrame* frame, bluOpCode genericOp) {
+	frame->ip[-1] = genericOp;
+	frame->ip--;
+}
+
+#ifdef BLU_JIT
+static void countHotness(bluVM* vm, bluObjFunction* function) {
+	if (function->obj.isShared) return;
+
+	if (++function->hotness == JIT_THRESHOLD && vm->jitEnabled) {
+		bluJitCompile(vm, function);
+	}
+}
+#endif
+
+// Moves the value stack to a new allocation of [size] slots and points the frames and open upvalues to it.
+static void resizeStack(bluVM* vm, int32_t size) {
+	bluValue* stack = malloc(sizeof(bluValue) * size);
+	memcpy(stack, vm->stack, sizeof(bluValue) * (vm->stackTop - vm->stack));
+
+	for (int32_t i = 0; i < vm->frameCount; i++) {
+		vm->frames[i].slots = stack + (vm->frames[i].slots - vm->stack);
+	}
+
+	for (bluObjUpvalue* upvalue = vm->openUpvalues; upvalue != NULL; upvalue = upvalue->next) {
+		upvalue->value = stack + (upvalue->value - vm->stack);
+	}
+
+	vm->stackTop = stack + (vm->stackTop - vm->stack);
+
+	free(vm->stack);
+	vm->stack = stack;
+	vm->stackSize = size;
+}
+
+// Makes sure there is room for [count] more values on the stack. Pointers into the stack are only valid until the
+// next call of this.
+static inline void reserveStack(bluVM* vm, int32_t count) {
+	int32_t needed = (int32_t)(vm->stackTop - vm->stack) + count;
+
+#ifndef DEBUG_STACK_STRESS
+	if (needed <= vm->stackSize) return;
+#endif
+
+	int32_t size = vm->stackSize;
+	while (size < needed) size *= 2;
+
+	resizeStack(vm, size);
+}
+
 static bool call(bluVM* vm, bluObjClosure* closure, int8_t argCount) {
 	if (argCount < closure->function->arity) {
 		runtimeError(vm, "Expected %d arguments but got %d.", closure->function->arity, argCount);
 		return false;
 	}
 
-	if (vm->frameCount == FRAMES_MAX) {
+	if (vm->frameCount == vm->framesMax) {
 		runtimeError(vm, "Stack overflow.");
 		return false;
 	}
 
+	if (vm->frameCount == vm->frameSize) {
+		vm->frameSize *= 2;
+		vm->frames = realloc(vm->frames, sizeof(bluCallFrame) * vm->frameSize);
+	}
+
+	reserveStack(vm, closure->function->slotCount + STACK_HEADROOM);
+
 	bluCallFrame* frame = &vm->frames[vm->frameCount++];
 	frame->closure = closure;
 	frame->ip = closure->function->chunk.code.data;
@@ -78,9 +246,81 @@ static bool call(bluVM* vm, bluObjClosure* closure, int8_t argCount) {
 	// +1 to include either the called function or the receiver.
 	frame->slots = vm->stackTop - (argCount + 1);
 
+	frame->regionMark = vm->regionTop;
+
+	if (vm->tracer != NULL) bluTraceEnter(vm, closure->function);
+
+#ifdef BLU_JIT
+	countHotness(vm, closure->function);
+#endif
+
 	return true;
 }
 
+// Does the switch requested by Fiber.resume() or Fiber.yield(). The native left its result slot on top of the stack,
+// it receives the value transferred back once the current fiber runs again.
+static bool switchFiber(bluVM* vm) {
+	bluObjFiber* fiber = vm->resumed;
+	bluValue value = vm->transfer;
+
+	vm->resumed = NULL;
+	vm->transfer = NIL_VAL;
+
+	if (vm->yielded) {
+		vm->yielded = false;
+
+		if (vm->fiber == NULL) {
+			runtimeError(vm, "Can't yield outside of a fiber.");
+			return false;
+		}
+
+		// Natives calling back into the VM wait for run() to return, the fiber can't be suspended under them.
+		if (vm->frameCountStart != 0) {
+			runtimeError(vm, "Can't yield across a native call.");
+			return false;
+		}
+
+		leaveFiber(vm, FIBER_SUSPENDED, value);
+		return true;
+	}
+
+	if (fiber->state == FIBER_RUNNING) {
+		runtimeError(vm, "Fiber is already running.");
+		return false;
+	}
+
+	if (fiber->state == FIBER_DONE) {
+		runtimeError(vm, "Can't resume a finished fiber.");
+		return false;
+	}
+
+	bool started = fiber->state == FIBER_NEW;
+
+	fiber->state = FIBER_RUNNING;
+	fiber->caller = vm->fiber;
+	vm->fiber = fiber;
+
+	swapStacks(vm, fiber);
+
+	if (!started) {
+		// Result of the yield the fiber is suspended in.
+		vm->stackTop[-1] = value;
+		return true;
+	}
+
+	// The first resume calls the function of the fiber, passing the value along if it takes an argument.
+	bluObjClosure* closure = IS_CLOSURE(fiber->callee) ? AS_CLOSURE(fiber->callee)
+	                                                   : AS_BOUND_METHOD(fiber->callee)->closure;
+
+	int8_t argCount = 0;
+	if (closure->function->arity > 0) {
+		bluPush(vm, value);
+		argCount = 1;
+	}
+
+	return callValue(vm, fiber->callee, argCount);
+}
+
 static bool callValue(bluVM* vm, bluValue callee, int8_t argCount) {
 	if (!IS_OBJ(callee)) {
 		runtimeError(vm, "Can only call functions and classes.");
@@ -98,10 +338,10 @@ static bool callValue(bluVM* vm, bluValue callee, int8_t argCount) {
 	}
 
 	case OBJ_CLASS: {
-		bluObjClass* class = AS_CLASS(callee);
-
 		// Create the instance.
-		vm->stackTop[-argCount - 1] = OBJ_VAL(bluNewInstance(vm, class));
+		vm->stackTop[-argCount - 1] = OBJ_VAL(bluNewInstance(vm, AS_CLASS(callee)));
+
+		bluObjClass* class = bluResolveClass(vm, AS_CLASS(callee));
 
 		// Call the initializer, if there is one.
 		bluValue initializer;
@@ -133,7 +373,13 @@ static bool callValue(bluVM* vm, bluValue callee, int8_t argCount) {
 			return false;
 		}
 
+		int64_t start = vm->tracer != NULL ? bluMonotonicTime() : 0;
+
 		int8_t result = native->function(vm, argCount, vm->stackTop - argCount - 1);
+
+		// Tracing may have started or stopped in the native.
+		if (vm->tracer != NULL && start != 0) bluTraceSpan(vm, TRACE_NATIVE, native->name->chars, start);
+
 		if (result < 0) {
 			runtimeError(vm, "Something went wrong.");
 			return false;
@@ -141,6 +387,8 @@ static bool callValue(bluVM* vm, bluValue callee, int8_t argCount) {
 
 		vm->stackTop -= argCount + 1 - result;
 
+		if (vm->resumed != NULL || vm->yielded) return switchFiber(vm);
+
 		return true;
 	}
 
@@ -152,6 +400,8 @@ static bool callValue(bluVM* vm, bluValue callee, int8_t argCount) {
 }
 
 static bool invokeFromClass(bluVM* vm, bluObjClass* class, bluObjString* name, int8_t argCount) {
+	class = bluResolveClass(vm, class);
+
 	// Look for the method.
 	bluValue method;
 	if (!bluTableGet(vm, &class->methods, name, &method)) {
@@ -170,6 +420,72 @@ static bool invokeFromClass(bluVM* vm, bluObjClass* class, bluObjString* name, i
 	return call(vm, AS_CLOSURE(method), argCount);
 }
 
+// Returns the function which will run when [callee] is called, or NULL when it is a native.
+static bluObjFunction* callTarget(bluVM* vm, bluValue callee) {
+	if (!IS_OBJ(callee)) return NULL;
+
+	switch (OBJ_TYPE(callee)) {
+	case OBJ_BOUND_METHOD: return AS_BOUND_METHOD(callee)->closure->function;
+	case OBJ_CLOSURE: return AS_CLOSURE(callee)->function;
+
+	case OBJ_CLASS: {
+		bluValue initializer;
+		if (bluTableGet(vm, &bluResolveClass(vm, AS_CLASS(callee))->methods, vm->stringInitializer, &initializer)) {
+			return callTarget(vm, initializer);
+		}
+
+		return NULL;
+	}
+
+	default: return NULL;
+	}
+}
+
+// Returns the function which will run when the method [name] is invoked on the receiver, or NULL when it is a native.
+// Mirrors the lookup done by invoke().
+static bluObjFunction* invokeTarget(bluVM* vm, bluObjString* name, int8_t argCount) {
+	bluValue receiver = bluPeek(vm, argCount);
+	bluValue value;
+
+	if (IS_INSTANCE(receiver) && bluTableGet(vm, &AS_INSTANCE(receiver)->fields, name, &value)) {
+		return callTarget(vm, value);
+	} else if (IS_CLASS(receiver) && bluTableGet(vm, &bluResolveClass(vm, AS_CLASS(receiver))->fields, name, &value)) {
+		return callTarget(vm, value);
+	}
+
+	for (bluObjClass* class = bluGetClass(vm, receiver); class != NULL; class = class->superclass) {
+		class = bluResolveClass(vm, class);
+		if (bluTableGet(vm, &class->methods, name, &value)) return callTarget(vm, value);
+	}
+
+	return NULL;
+}
+
+// Moves the region allocated arguments of a call to the heap, unless [target] is known not to retain them.
+static void promoteArguments(bluVM* vm, bluObjFunction* target, int8_t argCount) {
+	bluValue* args = vm->stackTop - argCount;
+
+	for (int8_t i = 0; i < argCount; i++) {
+		if (!IS_OBJ(args[i]) || !bluIsRegionObject(vm, AS_OBJ(args[i]))) continue;
+
+		if (target == NULL || i >= target->arity || i >= 8 || (target->escapingParameters & (1 << i))) {
+			args[i] = OBJ_VAL(bluPromoteObject(vm, AS_OBJ(args[i])));
+		}
+	}
+}
+
+// Hands the region allocated arguments left after promoteArguments() over to the frame of the callee, so they are
+// released as soon as it returns.
+static void releaseArgumentsOnReturn(bluVM* vm, bluCallFrame* frame, int8_t argCount) {
+	for (int8_t i = 1; i <= argCount; i++) {
+		bluValue arg = frame->slots[i];
+
+		if (IS_OBJ(arg) && bluIsRegionObject(vm, AS_OBJ(arg)) && (uint8_t*)AS_OBJ(arg) < frame->regionMark) {
+			frame->regionMark = (uint8_t*)AS_OBJ(arg);
+		}
+	}
+}
+
 static bool invoke(bluVM* vm, bluObjString* name, int8_t argCount) {
 	bluValue receiver = bluPeek(vm, argCount);
 
@@ -180,7 +496,7 @@ static bool invoke(bluVM* vm, bluObjString* name, int8_t argCount) {
 		}
 	} else if (IS_CLASS(receiver)) {
 		bluValue value;
-		if (bluTableGet(vm, &AS_CLASS(receiver)->fields, name, &value)) {
+		if (bluTableGet(vm, &bluResolveClass(vm, AS_CLASS(receiver))->fields, name, &value)) {
 			return callValue(vm, value, argCount);
 		}
 	}
@@ -238,14 +554,63 @@ static void closeUpvalues(bluVM* vm, bluValue* last) {
 	}
 }
 
-static bool bindMethod(bluVM* vm, bluObjClass* class, bluObjString* name) {
+// Calls [callee] in place of the current frame instead of pushing a new one. Only closures and bound methods reuse the
+// frame, anything else is called as usual and its result is returned by the OP_RETURN following the tail call.
+static bool tailCall(bluVM* vm, bluValue callee, int8_t argCount) {
+	bluObjClosure* closure;
+
+	if (IS_CLOSURE(callee)) {
+		closure = AS_CLOSURE(callee);
+	} else if (IS_BOUND_METHOD(callee)) {
+		closure = AS_BOUND_METHOD(callee)->closure;
+		vm->stackTop[-argCount - 1] = AS_BOUND_METHOD(callee)->receiver;
+	} else {
+		return callValue(vm, callee, argCount);
+	}
+
+	if (argCount < closure->function->arity) {
+		runtimeError(vm, "Expected %d arguments but got %d.", closure->function->arity, argCount);
+		return false;
+	}
+
+	bluCallFrame* frame = &vm->frames[vm->frameCount - 1];
+
+	closeUpvalues(vm, frame->slots);
+
+	// Slide the callee and its arguments down over the slots of the finished function.
+	bluValue* args = vm->stackTop - (argCount + 1);
+	memmove(frame->slots, args, sizeof(bluValue) * (argCount + 1));
+	vm->stackTop = frame->slots + argCount + 1;
+
+	reserveStack(vm, closure->function->slotCount + STACK_HEADROOM);
+
+	frame->closure = closure;
+	frame->ip = closure->function->chunk.code.data;
+
+	// The region mark is kept, the callee or its arguments may still be allocated in the region of the replaced frame.
+
+	if (vm->tracer != NULL) {
+		bluTraceExit(vm);
+		bluTraceEnter(vm, closure->function);
+	}
+
+#ifdef BLU_JIT
+	countHotness(vm, closure->function);
+#endif
+
+	return true;
+}
+
+static bool bindMethod(bluVM* vm, bluObjClass* class, bluObjString* name, bool inRegion) {
 	bluValue method;
-	if (!bluTableGet(vm, &class->methods, name, &method)) {
+	if (!bluTableGet(vm, &bluResolveClass(vm, class)->methods, name, &method)) {
 		runtimeError(vm, "Undefined property '%s'.", name->chars);
 		return false;
 	}
 
-	bluObjBoundMethod* bound = bluNewBoundMethod(vm, bluPop(vm), AS_CLOSURE(method));
+	bluValue receiver = bluPop(vm);
+	bluObjBoundMethod* bound = inRegion ? bluNewRegionBoundMethod(vm, receiver, AS_CLOSURE(method))
+										: bluNewBoundMethod(vm, receiver, AS_CLOSURE(method));
 	bluPush(vm, OBJ_VAL(bound));
 
 	return true;
@@ -280,11 +645,31 @@ static bool import(bluVM* vm, bluObjString* moduleName) {
 	return importModule(vm, moduleName);
 }
 
+#ifdef BLU_REGISTER_VM
+static inline bluValue readRegisterOperand(bluCallFrame* frame, bluValue* slots) {
+	uint16_t operand = (uint16_t)((frame->ip[0] << 8) | frame->ip[1]);
+	frame->ip += 2;
+
+	if (operand & RK_CONSTANT) {
+		return frame->closure->function->chunk.constants.data[operand & RK_MAX];
+	}
+
+	return slots[operand];
+}
+#endif
+
 static bluInterpretResult run(bluVM* vm) {
 
 	register bluCallFrame* frame;
 	register bluValue* slots;
 
+#ifdef BLU_JIT
+	bluJitCode* jitCode;
+#define LOAD_JIT_CODE() jitCode = frame->closure->function->jit
+#else
+#define LOAD_JIT_CODE()
+#endif
+
 #define PUSH(value) bluPush(vm, value)
 #define POP() bluPop(vm)
 #define DROP() (--(vm->stackTop))
@@ -293,18 +678,30 @@ static bluInterpretResult run(bluVM* vm) {
 #define READ_SHORT() (frame->ip += 2, (uint16_t)((frame->ip[-2] << 8) | frame->ip[-1]))
 #define READ_CONSTANT() (frame->closure->function->chunk.constants.data[READ_SHORT()])
 #define READ_STRING() AS_STRING(READ_CONSTANT())
+#define READ_RK() readRegisterOperand(frame, slots)
 
 #define RUNTIME_ERROR(...) runtimeError(vm, __VA_ARGS__)
 
 #define LOAD_FRAME()                                                                                                   \
 	frame = &vm->frames[vm->frameCount - 1];                                                                           \
-	slots = frame->slots;
+	slots = frame->slots;                                                                                              \
+	LOAD_JIT_CODE();
 
 	LOAD_FRAME();
 
 	while (true) {
 
 		if (vm->shouldGC) bluCollectGarbage(vm);
+		if (vm->shouldSample) bluTakeSample(vm);
+
+#ifdef BLU_JIT
+		// Native code runs until an instruction it can't handle, which is then dispatched below.
+		if (jitCode != NULL) bluJitEnter(vm, frame, jitCode);
+#endif
+
+#ifdef BLU_COUNT_INSTRUCTIONS
+		vm->instructionCount++;
+#endif
 
 #ifdef DEBUG_VM_TRACE
 		bluDisassembleInstruction(&frame->closure->function->chunk,
@@ -313,6 +710,12 @@ static bluInterpretResult run(bluVM* vm) {
 
 		uint8_t instruction = READ_BYTE();
 
+#ifdef BLU_OPSTATS
+		vm->opCounts[instruction]++;
+		if (vm->previousOp != OP_COUNT) vm->opPairs[vm->previousOp][instruction]++;
+		vm->previousOp = instruction;
+#endif
+
 		switch (instruction) {
 
 		case OP_CONSTANT: {
@@ -335,10 +738,12 @@ static bluInterpretResult run(bluVM* vm) {
 			break;
 		}
 
-		case OP_ARRAY: {
+		case OP_ARRAY:
+		case OP_ARRAY_REGION: {
+			bool inRegion = frame->ip[-1] == OP_ARRAY_REGION;
 			uint16_t len = READ_SHORT();
 
-			bluObjArray* array = bluNewArray(vm, len);
+			bluObjArray* array = inRegion ? bluNewRegionArray(vm, len) : bluNewArray(vm, len);
 
 			for (uint16_t i = 0; i < len; i++) {
 				// Expressions are on tzhe stack in reverse order to which we want them in the array.
@@ -411,7 +816,9 @@ static bluInterpretResult run(bluVM* vm) {
 			break;
 		}
 
-		case OP_GET_PROPERTY: {
+		case OP_GET_PROPERTY:
+		case OP_GET_PROPERTY_REGION: {
+			bool inRegion = frame->ip[-1] == OP_GET_PROPERTY_REGION;
 			bluValue receiver = PEEK(0);
 			bluObjString* name = READ_STRING();
 
@@ -427,14 +834,14 @@ static bluInterpretResult run(bluVM* vm) {
 				}
 			} else {
 				bluValue value;
-				if (bluTableGet(vm, &AS_CLASS(receiver)->fields, name, &value)) {
+				if (bluTableGet(vm, &bluResolveClass(vm, AS_CLASS(receiver))->fields, name, &value)) {
 					DROP(); // Receiver.
 					PUSH(value);
 					break;
 				}
 			}
 
-			if (!bindMethod(vm, bluGetClass(vm, receiver), name)) {
+			if (!bindMethod(vm, bluGetClass(vm, receiver), name, inRegion)) {
 				RUNTIME_ERROR("No such property.");
 				return INTERPRET_RUNTIME_ERROR;
 			}
@@ -451,7 +858,7 @@ static bluInterpretResult run(bluVM* vm) {
 			} else if (IS_INSTANCE(receiver)) {
 				bluTableSet(vm, &AS_INSTANCE(receiver)->fields, READ_STRING(), PEEK(0));
 			} else {
-				bluTableSet(vm, &AS_CLASS(receiver)->fields, READ_STRING(), PEEK(0));
+				bluTableSet(vm, &bluWritableClass(vm, AS_CLASS(receiver))->fields, READ_STRING(), PEEK(0));
 			}
 
 			bluValue value = POP();
@@ -465,7 +872,7 @@ static bluInterpretResult run(bluVM* vm) {
 			bluObjString* name = READ_STRING();
 			bluObjClass* superclass = AS_CLASS(POP());
 
-			if (!bindMethod(vm, superclass, name)) {
+			if (!bindMethod(vm, superclass, name, false)) {
 				return INTERPRET_RUNTIME_ERROR;
 			}
 
@@ -487,7 +894,7 @@ static bluInterpretResult run(bluVM* vm) {
 				return INTERPRET_RUNTIME_ERROR;
 			}
 
-			bluObjClass* class = bluGetClass(vm, receiver);
+			bluObjClass* class = bluResolveClass(vm, bluGetClass(vm, receiver));
 
 			bluValue method;
 
@@ -556,6 +963,35 @@ static bluInterpretResult run(bluVM* vm) {
 			break;
 		}
 
+		case OP_TAIL_CALL: {
+			uint8_t argCount = READ_BYTE();
+
+			if (!tailCall(vm, PEEK(argCount), argCount)) {
+				return INTERPRET_RUNTIME_ERROR;
+			}
+
+			LOAD_FRAME();
+
+			break;
+		}
+
+		case OP_CALL_REGION: {
+			uint8_t argCount = READ_BYTE();
+			int32_t frameCount = vm->frameCount;
+
+			promoteArguments(vm, callTarget(vm, PEEK(argCount)), argCount);
+
+			if (!callValue(vm, PEEK(argCount), argCount)) {
+				return INTERPRET_RUNTIME_ERROR;
+			}
+
+			LOAD_FRAME();
+
+			if (vm->frameCount > frameCount) releaseArgumentsOnReturn(vm, frame, argCount);
+
+			break;
+		}
+
 		case OP_INVOKE: {
 			uint8_t argCount = READ_BYTE();
 			bluObjString* name = READ_STRING();
@@ -569,6 +1005,24 @@ static bluInterpretResult run(bluVM* vm) {
 			break;
 		}
 
+		case OP_INVOKE_REGION: {
+			uint8_t argCount = READ_BYTE();
+			bluObjString* name = READ_STRING();
+			int32_t frameCount = vm->frameCount;
+
+			promoteArguments(vm, invokeTarget(vm, name, argCount), argCount);
+
+			if (!invoke(vm, name, argCount)) {
+				return INTERPRET_RUNTIME_ERROR;
+			}
+
+			LOAD_FRAME();
+
+			if (vm->frameCount > frameCount) releaseArgumentsOnReturn(vm, frame, argCount);
+
+			break;
+		}
+
 		case OP_SUPER: {
 			uint8_t argCount = READ_BYTE();
 			bluObjString* name = READ_STRING();
@@ -604,6 +1058,12 @@ static bluInterpretResult run(bluVM* vm) {
 		case OP_LOOP: {
 			uint16_t offset = READ_SHORT();
 			frame->ip -= offset;
+
+#ifdef BLU_JIT
+			countHotness(vm, frame->closure->function);
+			LOAD_JIT_CODE();
+#endif
+
 			break;
 		}
 
@@ -628,29 +1088,32 @@ static bluInterpretResult run(bluVM* vm) {
 		}
 
 		case OP_GREATER: {
-			BINARY_OP(BOOL_VAL, >);
+			BINARY_OP(BOOL_VAL, >, OP_GREATER_NUM);
 			break;
 		}
 
 		case OP_GREATER_EQUAL: {
-			BINARY_OP(BOOL_VAL, >=);
+			BINARY_OP(BOOL_VAL, >=, OP_GREATER_EQUAL_NUM);
 			break;
 		}
 
 		case OP_LESS: {
-			BINARY_OP(BOOL_VAL, <);
+			BINARY_OP(BOOL_VAL, <, OP_LESS_NUM);
 			break;
 		}
 
 		case OP_LESS_EQUAL: {
-			BINARY_OP(BOOL_VAL, <=);
+			BINARY_OP(BOOL_VAL, <=, OP_LESS_EQUAL_NUM);
 			break;
 		}
 
 		case OP_ADD: {
 			if (IS_STRING(PEEK(0)) && IS_STRING(PEEK(1))) {
+				quicken(frame, FEEDBACK_STRING, OP_ADD_STR);
 				concatenate(vm);
 			} else if (IS_NUMBER(PEEK(0)) && IS_NUMBER(PEEK(1))) {
+				quicken(frame, FEEDBACK_NUMBER, OP_ADD_NUM);
+
 				double left = AS_NUMBER(POP());
 				double right = AS_NUMBER(POP());
 
@@ -664,7 +1127,7 @@ static bluInterpretResult run(bluVM* vm) {
 		}
 
 		case OP_DIVIDE: {
-			BINARY_OP(NUMBER_VAL, /);
+			BINARY_OP(NUMBER_VAL, /, OP_DIVIDE_NUM);
 			break;
 		}
 
@@ -684,12 +1147,12 @@ static bluInterpretResult run(bluVM* vm) {
 		}
 
 		case OP_SUBTRACT: {
-			BINARY_OP(NUMBER_VAL, -);
+			BINARY_OP(NUMBER_VAL, -, OP_SUBTRACT_NUM);
 			break;
 		}
 
 		case OP_MULTIPLY: {
-			BINARY_OP(NUMBER_VAL, *);
+			BINARY_OP(NUMBER_VAL, *, OP_MULTIPLY_NUM);
 			break;
 		}
 
@@ -705,6 +1168,56 @@ static bluInterpretResult run(bluVM* vm) {
 			break;
 		}
 
+		case OP_GREATER_NUM: {
+			NUMBER_OP(BOOL_VAL, >, OP_GREATER);
+			break;
+		}
+
+		case OP_GREATER_EQUAL_NUM: {
+			NUMBER_OP(BOOL_VAL, >=, OP_GREATER_EQUAL);
+			break;
+		}
+
+		case OP_LESS_NUM: {
+			NUMBER_OP(BOOL_VAL, <, OP_LESS);
+			break;
+		}
+
+		case OP_LESS_EQUAL_NUM: {
+			NUMBER_OP(BOOL_VAL, <=, OP_LESS_EQUAL);
+			break;
+		}
+
+		case OP_ADD_NUM: {
+			NUMBER_OP(NUMBER_VAL, +, OP_ADD);
+			break;
+		}
+
+		case OP_DIVIDE_NUM: {
+			NUMBER_OP(NUMBER_VAL, /, OP_DIVIDE);
+			break;
+		}
+
+		case OP_SUBTRACT_NUM: {
+			NUMBER_OP(NUMBER_VAL, -, OP_SUBTRACT);
+			break;
+		}
+
+		case OP_MULTIPLY_NUM: {
+			NUMBER_OP(NUMBER_VAL, *, OP_MULTIPLY);
+			break;
+		}
+
+		case OP_ADD_STR: {
+			if (!IS_STRING(PEEK(0)) || !IS_STRING(PEEK(1))) {
+				deoptimize(frame, OP_ADD);
+				break;
+			}
+
+			concatenate(vm);
+			break;
+		}
+
 		case OP_NOT: {
 			bluValue value = POP();
 
@@ -725,15 +1238,115 @@ static bluInterpretResult run(bluVM* vm) {
 			break;
 		}
 
+#ifdef BLU_REGISTER_VM
+		case OP_EQUAL_RK: {
+			bluValue left = READ_RK();
+			bluValue right = READ_RK();
+
+			PUSH(BOOL_VAL(bluValuesEqual(left, right)));
+			break;
+		}
+
+		case OP_NOT_EQUAL_RK: {
+			bluValue left = READ_RK();
+			bluValue right = READ_RK();
+
+			PUSH(BOOL_VAL(!bluValuesEqual(left, right)));
+			break;
+		}
+
+		case OP_GREATER_RK: {
+			BINARY_OP_RK(BOOL_VAL, >);
+			break;
+		}
+
+		case OP_GREATER_EQUAL_RK: {
+			BINARY_OP_RK(BOOL_VAL, >=);
+			break;
+		}
+
+		case OP_LESS_RK: {
+			BINARY_OP_RK(BOOL_VAL, <);
+			break;
+		}
+
+		case OP_LESS_EQUAL_RK: {
+			BINARY_OP_RK(BOOL_VAL, <=);
+			break;
+		}
+
+		case OP_ADD_RK: {
+			bluValue left = READ_RK();
+			bluValue right = READ_RK();
+
+			if (IS_STRING(left) && IS_STRING(right)) {
+				PUSH(left);
+				PUSH(right);
+				concatenate(vm);
+			} else if (IS_NUMBER(left) && IS_NUMBER(right)) {
+				PUSH(NUMBER_VAL(AS_NUMBER(left) + AS_NUMBER(right)));
+			} else {
+				RUNTIME_ERROR("Operands must be both numbers or strings.");
+				return INTERPRET_RUNTIME_ERROR;
+			}
+
+			break;
+		}
+
+		case OP_DIVIDE_RK: {
+			BINARY_OP_RK(NUMBER_VAL, /);
+			break;
+		}
+
+		case OP_REMINDER_RK: {
+			bluValue left = READ_RK();
+			bluValue right = READ_RK();
+
+			if (!IS_NUMBER(left) || !IS_NUMBER(right)) {
+				RUNTIME_ERROR("Operands must be numbers.");
+				return INTERPRET_RUNTIME_ERROR;
+			}
+
+			PUSH(NUMBER_VAL((int)AS_NUMBER(left) % (int)AS_NUMBER(right)));
+			break;
+		}
+
+		case OP_SUBTRACT_RK: {
+			BINARY_OP_RK(NUMBER_VAL, -);
+			break;
+		}
+
+		case OP_MULTIPLY_RK: {
+			BINARY_OP_RK(NUMBER_VAL, *);
+			break;
+		}
+
+		case OP_POWER_RK: {
+			bluValue base = READ_RK();
+			bluValue exponent = READ_RK();
+
+			if (!IS_NUMBER(base) || !IS_NUMBER(exponent)) {
+				RUNTIME_ERROR("Operands must be numbers.");
+				return INTERPRET_RUNTIME_ERROR;
+			}
+
+			PUSH(NUMBER_VAL(pow(AS_NUMBER(base), AS_NUMBER(exponent))));
+			break;
+		}
+
+#endif
+
 		case OP_CLOSE_OPVALUE: {
 			closeUpvalues(vm, vm->stackTop - 1);
 			DROP();
 			break;
 		}
 
-		case OP_CLOSURE: {
+		case OP_CLOSURE:
+		case OP_CLOSURE_REGION: {
+			bool inRegion = frame->ip[-1] == OP_CLOSURE_REGION;
 			bluObjFunction* function = AS_FUNCTION(READ_CONSTANT());
-			bluObjClosure* closure = newClosure(vm, function);
+			bluObjClosure* closure = inRegion ? bluNewRegionClosure(vm, function) : newClosure(vm, function);
 			PUSH(OBJ_VAL(closure));
 
 			for (uint16_t i = 0; i < function->upvalueCount; i++) {
@@ -780,7 +1393,7 @@ static bluInterpretResult run(bluVM* vm) {
 		case OP_METHOD_FOREIGN: {
 			bluObjString* name = READ_STRING();
 			bluObjClass* class = AS_CLASS(POP());
-			bluTableSet(vm, &class->methods, name, OBJ_VAL(bluNewNative(vm, NULL, -1)));
+			bluTableSet(vm, &class->methods, name, OBJ_VAL(bluNewNative(vm, name, NULL, -1)));
 			break;
 		}
 
@@ -797,12 +1410,16 @@ static bluInterpretResult run(bluVM* vm) {
 				return INTERPRET_RUNTIME_ERROR;
 			}
 
+			// Modules run on the same stacks, which might have moved.
+			LOAD_FRAME();
+
 			break;
 		}
 
 		case OP_ECHO: {
-			bluPrintValue(POP());
-			printf("\n");
+			bluFormatValue(&vm->output, POP());
+			ByteBufferAppend(&vm->output, "\n", 1);
+			bluFlushOutputIfFull(vm);
 			break;
 		}
 
@@ -810,15 +1427,24 @@ static bluInterpretResult run(bluVM* vm) {
 			bluValue result = POP();
 			vm->frameCount--;
 
+			if (vm->tracer != NULL) bluTraceExit(vm);
+
 			closeUpvalues(vm, slots);
 
+			if (vm->regionTop != frame->regionMark) bluReleaseRegion(vm, frame->regionMark);
+
 			if (vm->frameCount == vm->frameCountStart) {
-#if DEBUG
-				if (vm->stackTop - vm->stack != 0) {
-					RUNTIME_ERROR("Stack not empty!");
-					return INTERPRET_RUNTIME_ERROR;
+				// The function of a fiber returned, its result goes back to the fiber which resumed it.
+				if (vm->fiber != NULL && vm->frameCount == 0) {
+					leaveFiber(vm, FIBER_DONE, result);
+
+					LOAD_FRAME();
+					break;
 				}
-#endif
+
+				// The caller of run() drops the slots of the frame, this leaves the result on top of them.
+				PUSH(result);
+
 				return INTERPRET_OK;
 			}
 
@@ -860,9 +1486,59 @@ static bluInterpretResult run(bluVM* vm) {
 	}
 }
 
+void bluInitVMConfig(bluVMConfig* config) {
+	config->stackSize = STACK_SIZE;
+	config->frameSize = FRAME_SIZE;
+	config->framesMax = FRAMES_MAX;
+	config->image = NULL;
+	config->outputBufferSize = -1;
+	config->startupHook = NULL;
+	config->startupData = NULL;
+}
+
+static const char* startupPhaseNames[] = {
+	[BLU_STARTUP_CORE_COMPILED] = "core compiled",
+	[BLU_STARTUP_CORE_NATIVES] = "core natives",
+	[BLU_STARTUP_MODULES] = "modules registered",
+	[BLU_STARTUP_IMAGE_ATTACHED] = "image attached",
+	[BLU_STARTUP_SCRIPT_COMPILED] = "script compiled",
+	[BLU_STARTUP_FIRST_INSTRUCTION] = "first instruction",
+};
+
+const char* bluStartupPhaseName(bluStartupPhase phase) {
+	return startupPhaseNames[phase];
+}
+
+void bluTraceStartup(bluVM* vm, bluStartupPhase phase) {
+	if (vm->startupHook != NULL) vm->startupHook(vm, phase, bluMonotonicTime(), vm->startupData);
+}
+
 bluVM* bluNewVM() {
+	bluVMConfig config;
+	bluInitVMConfig(&config);
+
+	return bluNewVMWithConfig(&config);
+}
+
+bluVM* bluNewVMWithConfig(const bluVMConfig* config) {
+	assert(config->stackSize > 0 && config->frameSize > 0);
+
 	bluVM* vm = malloc(sizeof(bluVM));
 
+	vm->stack = malloc(sizeof(bluValue) * config->stackSize);
+	vm->stackSize = config->stackSize;
+
+	vm->frames = malloc(sizeof(bluCallFrame) * config->frameSize);
+	vm->frameSize = config->frameSize;
+	vm->framesMax = config->framesMax;
+
+	vm->region = NULL;
+	vm->regionTop = NULL;
+	vm->regionObjects = NULL;
+
+	// Resetting the stack ends the functions traced on it.
+	vm->tracer = NULL;
+
 	resetStack(vm);
 
 	vm->frameCount = 0;
@@ -871,24 +1547,104 @@ bluVM* bluNewVM() {
 	vm->openUpvalues = NULL;
 	vm->objects = NULL;
 
+	vm->fiber = NULL;
+	vm->fibers = NULL;
+	vm->resumed = NULL;
+	vm->yielded = false;
+	vm->transfer = NIL_VAL;
+
+	// The core classes are created by bluInitStd(), objects allocated before that have no class.
+	vm->nilClass = NULL;
+	vm->boolClass = NULL;
+	vm->numberClass = NULL;
+	vm->arrayClass = NULL;
+	vm->classClass = NULL;
+	vm->functionClass = NULL;
+	vm->stringClass = NULL;
+	vm->fiberClass = NULL;
+	vm->stringInitializer = NULL;
+
+	vm->mappingClass = NULL;
+	vm->linesClass = NULL;
+	vm->viewClass = NULL;
+
+	vm->image = NULL;
+	vm->sharedClasses = NULL;
+
 	vm->bytesAllocated = 0;
 	vm->nextGC = 1024 * 1024;
 	vm->shouldGC = false;
+	vm->gcCount = 0;
 	vm->timeGC = 0;
+	vm->maxPauseGC = 0;
+	memset(vm->gcPauses, 0, sizeof(vm->gcPauses));
+
+	vm->jitEnabled = true;
+
+	vm->startupHook = config->startupHook;
+	vm->startupData = config->startupData;
+
+	vm->profiler = NULL;
+	vm->shouldSample = 0;
+	vm->allocationProfiler = NULL;
+
+	ByteBufferInit(&vm->output);
+	vm->outputLimit = config->outputBufferSize;
+	if (vm->outputLimit < 0) vm->outputLimit = isatty(STDOUT_FILENO) ? 0 : OUTPUT_BUFFER_SIZE;
+	vm->configuredOutputLimit = vm->outputLimit;
+
+#ifdef BLU_COUNT_INSTRUCTIONS
+	vm->instructionCount = 0;
+#endif
+
+#ifdef BLU_OPSTATS
+	memset(vm->opCounts, 0, sizeof(vm->opCounts));
+	memset(vm->opPairs, 0, sizeof(vm->opPairs));
+	vm->previousOp = OP_COUNT;
+#endif
 
 	bluTableInit(vm, &vm->globals);
 	bluTableInit(vm, &vm->strings);
 
 	bluModuleBufferInit(&vm->modules);
 
-	vm->stringInitializer = bluCopyString(vm, "__init", 6);
+	if (config->image != NULL) {
+		bluAttachImage(vm, config->image);
+		bluTraceStartup(vm, BLU_STARTUP_IMAGE_ATTACHED);
+	} else {
+		vm->stringInitializer = bluCopyString(vm, "__init", 6);
 
-	bluInitStd(vm);
+		bluInitStd(vm);
+	}
 
 	return vm;
 }
 
+void bluFlushOutput(bluVM* vm) {
+	if (vm->output.count == 0) return;
+
+	// Whatever went through stdio before has to come out first.
+	fflush(stdout);
+
+	for (int32_t written = 0; written < vm->output.count;) {
+		ssize_t count = write(STDOUT_FILENO, vm->output.data + written, vm->output.count - written);
+
+		if (count == -1 && errno != EINTR) break;
+		if (count > 0) written += count;
+	}
+
+	vm->output.count = 0;
+}
+
 void bluFreeVM(bluVM* vm) {
+	bluStopProfiler(vm, NULL);
+	bluStopAllocationProfiler(vm, NULL);
+	bluStopTrace(vm, NULL);
+
+	bluFlushOutput(vm);
+	ByteBufferFree(&vm->output);
+
+	bluReleaseRegion(vm, vm->region);
 	bluCollectMemory(vm);
 
 	bluTableFree(vm, &vm->globals);
@@ -902,6 +1658,19 @@ void bluFreeVM(bluVM* vm) {
 
 	bluModuleBufferFree(&vm->modules);
 
+	free(vm->region);
+	free(vm->sharedClasses);
+	free(vm->frames);
+	free(vm->stack);
+
+#ifdef BLU_COUNT_INSTRUCTIONS
+	fprintf(stderr, "Instructions executed: %" PRIu64 "\n", vm->instructionCount);
+#endif
+
+#ifdef BLU_OPSTATS
+	bluPrintOpStats(vm, stderr);
+#endif
+
 #ifdef DEBUG
 	assert(vm->bytesAllocated == 0);
 #endif
@@ -911,15 +1680,58 @@ void bluFreeVM(bluVM* vm) {
 
 bluInterpretResult bluInterpret(bluVM* vm, const char* source, const char* name) {
 	bluObjFunction* function = bluCompile(vm, source, name);
-	bluObjClosure* closure = newClosure(vm, function);
 
 	if (function == NULL) {
 		return INTERPRET_COMPILE_ERROR;
-	} else {
-		callValue(vm, OBJ_VAL(closure), 0);
+	}
+
+	bluTraceStartup(vm, BLU_STARTUP_SCRIPT_COMPILED);
+	ptrdiff_t base = vm->stackTop - vm->stack;
+
+	bluObjClosure* closure = newClosure(vm, function);
+	bluPush(vm, OBJ_VAL(closure));
+	callValue(vm, OBJ_VAL(closure), 0);
 
-		return run(vm);
+	// Startup ends here, later scripts aren't traced.
+	bluTraceStartup(vm, BLU_STARTUP_FIRST_INSTRUCTION);
+	vm->startupHook = NULL;
+
+	bluInterpretResult result = run(vm);
+	if (result != INTERPRET_OK) return result;
+
+#if DEBUG
+	// Top level code leaves nothing on the stack but its closure and the result.
+	if (vm->stackTop - vm->stack != base + 2) {
+		runtimeError(vm, "Stack not empty!");
+		return INTERPRET_RUNTIME_ERROR;
 	}
+#endif
+
+	vm->stackTop = vm->stack + base;
+
+	return INTERPRET_OK;
+}
+
+bluInterpretResult bluCall(bluVM* vm, int8_t argCount) {
+	ptrdiff_t base = vm->stackTop - argCount - 1 - vm->stack;
+
+	int32_t frameCountStart = vm->frameCountStart;
+	vm->frameCountStart = vm->frameCount;
+
+	bluInterpretResult result = INTERPRET_RUNTIME_ERROR;
+	if (callValue(vm, vm->stack[base], argCount)) {
+		result = vm->frameCount > vm->frameCountStart ? run(vm) : INTERPRET_OK;
+	}
+
+	vm->frameCountStart = frameCountStart;
+
+	if (result != INTERPRET_OK) return result;
+
+	bluValue value = bluPop(vm);
+	vm->stackTop = vm->stack + base;
+	bluPush(vm, value);
+
+	return INTERPRET_OK;
 }
 
 bluObjClass* bluGetClass(bluVM* vm, bluValue value) {
@@ -961,10 +1773,11 @@ bool bluDefineMethod(bluVM* vm, bluObj* obj, const char* name, bluNativeFn funct
 		return false;
 	}
 
-	bluObjNative* native = bluNewNative(vm, function, arity);
+	bluObjString* nameString = bluCopyString(vm, name, strlen(name));
+	bluObjNative* native = bluNewNative(vm, nameString, function, arity);
 
-	bluObjClass* class = (bluObjClass*)obj;
-	return bluTableSet(vm, &class->methods, bluCopyString(vm, name, strlen(name)), OBJ_VAL(native));
+	bluObjClass* class = bluWritableClass(vm, (bluObjClass*)obj);
+	return bluTableSet(vm, &class->methods, nameString, OBJ_VAL(native));
 }
 
 bool bluDefineStaticMethod(bluVM* vm, bluObj* obj, const char* name, bluNativeFn function, int8_t arity) {
@@ -972,10 +1785,15 @@ bool bluDefineStaticMethod(bluVM* vm, bluObj* obj, const char* name, bluNativeFn
 		return false;
 	}
 
-	bluObjNative* native = bluNewNative(vm, function, arity);
+	bluObjString* nameString = bluCopyString(vm, name, strlen(name));
+	bluObjNative* native = bluNewNative(vm, nameString, function, arity);
+
+	bluObjClass* class = bluWritableClass(vm, (bluObjClass*)obj);
+	return bluTableSet(vm, &class->fields, nameString, OBJ_VAL(native));
+}
 
-	bluObjClass* class = (bluObjClass*)obj;
-	return bluTableSet(vm, &class->fields, bluCopyString(vm, name, strlen(name)), OBJ_VAL(native));
+void bluSetJitEnabled(bluVM* vm, bool enabled) {
+	vm->jitEnabled = enabled;
 }
 
 void bluRegisterModule(bluVM* vm, const char* name, bluModuleLoader loader) {
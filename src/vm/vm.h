@@ -3,34 +3,82 @@
 
 #include "compiler/chunk.h"
 #include "include/blu.h"
+#include "vm/common.h"
 #include "vm/object.h"
+#include "vm/profiler.h"
 #include "vm/table.h"
+#include "vm/tracer.h"
 #include "vm/value.h"
 
-#define FRAMES_MAX 256
-#define STACK_MAX (FRAMES_MAX * (UINT8_MAX + 1))
+#define STACK_SIZE 256
+#define FRAME_SIZE 16
+#define FRAMES_MAX (1 << 18)
+
+// Fibers start with room for the headroom of two frames, their stacks grow like the one of the VM.
+#define FIBER_STACK_SIZE (STACK_HEADROOM * 2)
+#define FIBER_FRAME_SIZE 4
+
+// Number of values, on top of the deepest its own code gets, every call frame has room for without checking the stack
+// size. Calls made from C push their callee and arguments into it.
+#define STACK_HEADROOM (UINT8_MAX + 1)
+#define REGION_SIZE (64 * 1024)
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
 
 DECLARE_BUFFER(bluModule, bluModule);
 
-typedef struct {
+struct bluCallFrame {
 	bluObjClosure* closure;
 	uint8_t* ip;
 	bluValue* slots;
-} bluCallFrame;
+
+	// Top of the region when the frame was entered. Everything allocated in the region above it is released when the
+	// frame returns.
+	uint8_t* regionMark;
+};
 
 struct bluVM {
-	bluValue stack[STACK_MAX];
+	// Both stacks grow when a call needs more room. Growing the value stack moves it, so frame slots and open upvalues
+	// are pointed to the new one.
+	bluValue* stack;
 	bluValue* stackTop;
+	int32_t stackSize;
 
-	bluCallFrame frames[FRAMES_MAX];
+	bluCallFrame* frames;
 	int32_t frameCount;
 	int32_t frameCountStart;
+	int32_t frameSize;
+	int32_t framesMax;
+
+	// Fiber running now, or NULL while the VM runs on its own stacks. The stacks, the open upvalues and the region above
+	// always belong to the running fiber.
+	bluObjFiber* fiber;
+	bluObjFiber* fibers;
+
+	// Switch of fibers requested by a native, done once the native returns. [transfer] becomes the result of the call
+	// the other fiber is waiting in.
+	bluObjFiber* resumed;
+	bool yielded;
+	bluValue transfer;
 
 	bluTable globals;
 	bluTable strings;
 
+	// Printed output, written out once it's longer than [outputLimit], before reading input and when the VM is reset or
+	// freed.
+	ByteBuffer output;
+	int32_t outputLimit;
+
+	// Limit the VM was configured with, scripts changing [outputLimit] only change it until the VM is reset.
+	int32_t configuredOutputLimit;
+
 	bluObjUpvalue* openUpvalues;
 
+	// Objects which never outlive the frame that allocated them are bump allocated here instead of on the heap. They
+	// are linked in [regionObjects], newest first. The region is allocated on first use.
+	uint8_t* region;
+	uint8_t* regionTop;
+	bluObj* regionObjects;
+
 	bluObjClass* nilClass;
 	bluObjClass* boolClass;
 	bluObjClass* numberClass;
@@ -38,9 +86,20 @@ struct bluVM {
 	bluObjClass* classClass;
 	bluObjClass* functionClass;
 	bluObjClass* stringClass;
+	bluObjClass* fiberClass;
 
 	bluObjString* stringInitializer;
 
+	// Classes of the file module whose instances are made by natives, NULL until it's imported.
+	bluObjClass* mappingClass;
+	bluObjClass* linesClass;
+	bluObjClass* viewClass;
+
+	// Image the core library was taken from, or NULL. Shared classes of the image are looked up in [sharedClasses],
+	// which holds either the class itself or this VM's copy of it.
+	bluImage* image;
+	bluObjClass** sharedClasses;
+
 	// TODO : Use hashmap instead of array
 	bluModuleBuffer modules;
 
@@ -49,12 +108,67 @@ struct bluVM {
 	size_t bytesAllocated;
 	size_t nextGC;
 	bool shouldGC;
+
+	// Collections run, their pauses added up, the longest one and how many fell into each bucket of bluStats.
+	int64_t gcCount;
 	double timeGC;
+	double maxPauseGC;
+	int64_t gcPauses[BLU_PAUSE_BUCKETS];
+
+	bool jitEnabled;
+
+	// Hook of bluVMConfig, cleared once the first script runs its first instruction.
+	bluStartupHook startupHook;
+	void* startupData;
+
+	// Sampling profiler, or NULL. Its timer sets [shouldSample] from a signal handler, the interpreter takes the sample
+	// before the next instruction.
+	bluProfiler* profiler;
+	volatile sig_atomic_t shouldSample;
+
+	// Allocation profiler, or NULL. Objects allocated while it runs are counted towards its next sample.
+	bluProfiler* allocationProfiler;
+
+	// Tracer recording calls, natives and collections, or NULL.
+	bluTracer* tracer;
+
+#ifdef BLU_COUNT_INSTRUCTIONS
+	uint64_t instructionCount;
+#endif
+
+#ifdef BLU_OPSTATS
+	// Executions of each instruction and of each instruction following another. [previousOp] is OP_COUNT before the
+	// first one.
+	uint64_t opCounts[OP_COUNT];
+	uint64_t opPairs[OP_COUNT][OP_COUNT];
+	uint8_t previousOp;
+#endif
 };
 
+// Reports the end of [phase] to the startup hook, if there is one.
+void bluTraceStartup(bluVM* vm, bluStartupPhase phase);
+
 bool bluIsFalsey(bluValue value);
 bluObjClass* bluGetClass(bluVM* vm, bluValue value);
 
+// Calls the value below the [argCount] arguments on top of the stack and replaces the callee and the arguments with the
+// result.
+bluInterpretResult bluCall(bluVM* vm, int8_t argCount);
+
+static inline void bluFlushOutputIfFull(bluVM* vm) {
+	if (vm->output.count > vm->outputLimit) bluFlushOutput(vm);
+}
+
+static inline bool bluIsRegionObject(bluVM* vm, bluObj* object) {
+	return vm->region != NULL && (uint8_t*)object >= vm->region && (uint8_t*)object < vm->region + REGION_SIZE;
+}
+
+// Returns the class holding [class]'s methods and fields for this VM. Always use it before reading the tables of a class
+// which might come from an image.
+static inline bluObjClass* bluResolveClass(bluVM* vm, bluObjClass* class) {
+	return class->obj.isShared ? vm->sharedClasses[class->sharedIndex] : class;
+}
+
 static inline void bluPush(bluVM* vm, bluValue value) {
 	*((vm->stackTop)++) = value;
 }